@@ -3,35 +3,43 @@
  *
  *  Popis funkcí:
  *   - Zobrazení aktuálních hodin a minut na 7‑segmentovém displeji
- *   - Nastavení času (režim hodin)
- *   - Nastavení času budíku (režim budíku)
+ *   - Nastavení času a data (režim hodin), kalendář s přestupnými roky
+ *   - Pohledy MM.SS, DD.MM. a den v týdnu (klávesa A v normálním režimu)
+ *   - Nastavení až 8 budíků s výběrem dnů v týdnu (režim budíku)
  *   - Indikace režimů nastavování pomocí LED
  *       * PB2 – svítí při nastavování hodin
  *       * PB1 – svítí při nastavování budíku
  *   - Indikace uplynutí každé sekundy pomocí LED na PB3 (1 Hz)
  *   - Signalizace budíku blikáním LED na PB0, dokud není stisknuta libovolná klávesa
  *   - Po uložení hodin (ukončení režimu hodin) se sekundy vynulují
+ *   - Budíky a jas se ukládají do EEPROM (kruh slotů s CRC, zápis na pozadí)
+ *   - Volitelný záznam událostí do EEPROM pro diagnostiku (ZAZNAM)
  *   - Běh hodin i během nastavování budíku – bez zpoždění
  *
  * Vstupy:
  *   - Matice 4×4 klávesnice připojená na PORTC (nižší čtyři bity jako řádky, 
- *     horní čtyři bity jako sloupce s pull‑up rezistory)
+ *     horní čtyři bity jako sloupce s pull‑up rezistory), skenovaná
+ *     neblokujícím způsobem v přerušení časovače0 (jeden řádek za slot číslice)
  *   - Klávesy:
- *       0–9   – číslice
- *       A (10)– inkrementace hodin v režimu nastavování
- *       B (11)– inkrementace minut v režimu nastavování
+ *       0–9   – číslice (1–7 v režimu budíku přepínají dny pondělí–neděle)
+ *       A (10)– inkrementace hodin v režimu nastavování, jinak další pohled
+ *       B (11)– inkrementace minut v režimu nastavování, jinak zapnutí/vypnutí
+ *               automatického jasu (SVETLO)
  *       C (12)– vstup/výstup do režimu nastavování hodin
- *       D (13)– vstup/výstup do režimu nastavování budíku
- *       * (14)– není použito
- *       # (15)– není použito
+ *       D (13)– vstup/výstup do režimu nastavování budíku, v režimu hodin
+ *               přepnutí mezi zadáním času a data
+ *       * (14)– snížení jasu displeje, v režimu budíku zapnutí/vypnutí budíku
+ *       # (15)– zvýšení jasu displeje, v režimu budíku výběr dalšího budíku,
+ *               v režimu hodin další den v týdnu
  *
  * Výstupy:
  *   - 7‑segmentový displej na PORTA (segmenty) a PORTD (výběr pozice)
- *   - 4 LED na PB0–PB3 (aktivní low):
- *       PB0 – signalizace budíku (bliká 1 Hz při vyzvánění)
+ *   - 4 LED na PB0–PB3 (aktivní úroveň podle desky, DESKA v Makefile):
+ *       PB0 – signalizace budíku (bliká 1 Hz při vyzvánění, při odložení dvojitě)
  *       PB1 – indikace režimu nastavování budíku
  *       PB2 – indikace režimu nastavování hodin
- *       PB3 – sekundová indikace (1 Hz)
+ *       PB3 – sekundová indikace (1 Hz), rychle bliká při poškozeném nastavení,
+ *             dvojitě při zaseknuté klávese
  *
  * Created: 17.04.2025
  * Author : Michal Vavřiňák
@@ -39,301 +47,4239 @@
 
  //#define F_CPU 16000000 // 16 MHz - není potřeba, protože je definováno v Makefile
  #include <avr/io.h>         // knihovna pro práci s I/O porty mikrokontroléru
- #include <util/delay.h>     // knihovna pro zpoždění
  #include <avr/interrupt.h>  // knihovna pro ovládání přerušení
+ #include <avr/sleep.h>      // knihovna pro úsporné režimy
+ #include <avr/pgmspace.h>   // knihovna pro tabulky uložené ve flash (PROGMEM)
+ #include <avr/eeprom.h>     // knihovna pro práci s EEPROM
+ #include <avr/wdt.h>        // knihovna pro watchdog
+ #include <util/crc16.h>     // knihovna pro výpočet CRC
+ #include <util/atomic.h>    // knihovna pro atomické bloky (ATOMIC_BLOCK)
+ #include <util/delay.h>     // knihovna pro krátká zpoždění
+ #include <util/twi.h>       // knihovna s kódy stavů sběrnice TWI
  #include <stdint.h>         // knihovna pro celočíselné datové typy s pevnou délkou
+ #include <stddef.h>         // offsetof
+ #include <string.h>         // memcmp
+ 
+ // Čítače operací pro simulaci na PC (viz sim/simulace.cpp), ve firmwaru prázdné
+ #ifndef SIM_POCET
+ #define SIM_POCET(c)
+ #endif
+ #ifndef SIM_ZAZNAM
+ #define SIM_ZAZNAM(z)
+ #endif
  
  // Stavové konstanty pro režimy
  #define REZIM_NORMAL   0  // normální chod hodin
  #define REZIM_NAST_HOD 1  // nastavování hodin
  #define REZIM_NAST_BUD 2  // nastavování budíku
+ #define REZIM_KALIBRACE 3 // korekce kmitočtu krystalu (ppm)
+ #define REZIM_NAST_DAT 4  // nastavování data (z režimu hodin klávesou D)
+ 
+ // Pohledy normálního režimu, cyklicky přepínané klávesou A
+ #define POHLED_CAS     0  // HH.MM
+ #define POHLED_SEKUNDY 1  // MM.SS
+ #define POHLED_DATUM   2  // DD.MM.
+ #define POHLED_DEN     3  // den v týdnu („Po 1“ … „nE 7“)
+ #define POHLEDU        4
+ 
+ // Multiplex displeje (Timer0 v režimu CTC) – obnovovací frekvenci jedné
+ // číslice lze změnit zde nebo v makefile (OBNOVA_HZ), předdělička a OCR0
+ // se dopočítají při překladu
+ #ifndef OBNOVA_HZ
+ #define OBNOVA_HZ 200          // obnovovací frekvence jedné číslice [Hz] (100–400)
+ #endif
+ #ifndef ZATEMNENI_US
+ #define ZATEMNENI_US 40        // zatemnění mezi číslicemi proti „duchům“ [µs]
+ #endif
+ #define MUX_HZ (OBNOVA_HZ * 4UL)  // frekvence přepínání pozic (4 číslice)
+ 
+ #if   F_CPU / (1UL * MUX_HZ) <= 256
+ #define MUX_PREDDELICKA 1
+ #define MUX_CS          (1 << CS00)
+ #elif F_CPU / (8UL * MUX_HZ) <= 256
+ #define MUX_PREDDELICKA 8
+ #define MUX_CS          (1 << CS01)
+ #elif F_CPU / (64UL * MUX_HZ) <= 256
+ #define MUX_PREDDELICKA 64
+ #define MUX_CS          ((1 << CS01) | (1 << CS00))
+ #elif F_CPU / (256UL * MUX_HZ) <= 256
+ #define MUX_PREDDELICKA 256
+ #define MUX_CS          (1 << CS02)
+ #elif F_CPU / (1024UL * MUX_HZ) <= 256
+ #define MUX_PREDDELICKA 1024
+ #define MUX_CS          ((1 << CS02) | (1 << CS00))
+ #else
+ #error "OBNOVA_HZ je pro Timer0 příliš nízká"
+ #endif
+ 
+ // Délka slotu jedné číslice v tiktech Timer0 a jeho rozdělení na svit a zatemnění
+ #define MUX_PERIODA   ((F_CPU + MUX_PREDDELICKA * MUX_HZ / 2) / (MUX_PREDDELICKA * MUX_HZ))
+ #define MUX_ZATEMNENI ((ZATEMNENI_US * (F_CPU / 1000000UL) + MUX_PREDDELICKA - 1) / MUX_PREDDELICKA)
+ #define MUX_SVIT      (MUX_PERIODA - MUX_ZATEMNENI)
+ 
+ #if MUX_ZATEMNENI < 2 || MUX_SVIT < 2
+ #error "OBNOVA_HZ/ZATEMNENI_US: svit i zatemnění musí trvat alespoň 2 tiky Timer0"
+ #endif
+ 
+ // Jas displeje – 16 úrovní střídy svitu v rámci slotu číslice. Hodnota je
+ // OCR0 fáze svitu (svit trvá hodnota + 1 tiků, nejméně 2), zbytek slotu je
+ // tma. Průběh je kvadratický, aby kroky jasu vnímalo oko rovnoměrně.
+ #define JAS_UROVNI 16
+ #define JAS_OCR(k) (1 + (uint32_t)(MUX_SVIT - 2) * ((k) + 1) * ((k) + 1) / (JAS_UROVNI * JAS_UROVNI))
+ #define JAS_AUTO   0x80   // jas v EEPROM: řídí ho okolní světlo (SVETLO)
+ 
+ #ifdef SVETLO
+ // Automatický jas podle fotorezistoru (dělič proti zemi, víc světla = vyšší
+ // napětí) na kanálu ADC desky. Časovač CAS_SVETLO každých SVETLO_MS vyžádá
+ // jeden převod, který spustí ISR multiplexu v nejbližší fázi zatemnění,
+ // ISR(ADC_vect) výsledek zapracuje do klouzavého průměru (EMA) a hlavní
+ // smyčka z průměru s hysterezí vybere úroveň jasu.
+ #define SVETLO_MS        100
+ #define SVETLO_EMA       3      // váha nového vzorku 1/2^3, časová konstanta ≈ 0,8 s
+ #define SVETLO_KROK      2048   // šířka jedné úrovně jasu v jednotkách svetlo_ema
+ #define SVETLO_HYSTEREZE 512    // přesah za hranici úrovně nutný ke změně jasu
+ volatile uint16_t svetlo_ema = 0;  // průměr ADC × 32 (0–32736, zapisuje jen ISR)
+ volatile uint8_t svetlo_vyzadan = 0; // 1 = spustit převod v příštím zatemnění
+ uint8_t svetlo_auto = 0;           // 1 = jas řídí okolní světlo
+ #endif
+ 
+ // Příznaky a stavové proměnné sdílené s přerušeními. Každou proměnnou
+ // zapisuje jen jedna strana (ISR nebo hlavní smyčka) a všechny mají 8 bitů,
+ // takže čtení je atomické a není potřeba zakazovat přerušení.
+ volatile uint8_t sekundy_isr = 0;  // počet sekund od startu mod 256 (zapisuje jen ISR)
+ volatile uint8_t stav_led    = 0;  // toggle bit pro blikání 1 Hz
+ uint8_t sekundy_zpracovane   = 0;  // sekundy již započtené do času (zapisuje jen main)
+ 
+ uint8_t rezim_nastaveni = REZIM_NORMAL; // aktuální režim (normál/hodiny/budík/kalibrace)
+ uint8_t kurzor = 0;  // přímé zadání v REZIM_NAST_HOD/REZIM_NAST_DAT: 0 = levá … 3 = pravá číslice
+ 
+ // Časová základna 1 Hz – volí se při překladu (ZAKLADNA v makefile):
+ //   - výchozí: Timer1 v CTC z krystalu 16 MHz,
+ //   - ZAKLADNA_RTC: Timer2 asynchronně z hodinového krystalu 32,768 kHz
+ //     na TOSC1/TOSC2 (PC6/PC7) – běží i v SLEEP_MODE_PWR_SAVE a Timer1
+ //     zůstává volný. Sloupce 3 a 4 klávesnice jsou pak na PB4/PB5.
+ // Obě ISR základny jen volají zakladna_sekunda(), zbytek programu
+ // pracuje výhradně s čítačem sekundy_isr.
+ #define KOREKCE_MAX 999     // rozsah korekce ±999 ppm
+ int16_t korekce_ppm = 0;    // + = krystal se předbíhá (sekunda se prodlouží)
+ 
+ #ifdef ZAKLADNA_RTC
+ // Timer2: předdělička 128 → 256 tiků za sekundu, přerušení každou půlsekundu.
+ // Jeden tik je 3906,25 ppm sekundy = 15625 ve čtvrtinách ppm; korekce
+ // se rozkládá Bresenhamovým střádačem do délky první půlsekundy (±1 tik).
+ #define RTC_PULPERIODA 128u    // tiky Timer2 za půl sekundy
+ #define RTC_TIK_PPM4   15625   // jeden tik Timer2 ve čtvrtinách ppm za sekundu
+ volatile int16_t korekce_rtc = 0;  // korekce_ppm × 4
+ #else
+ // Timer1: jeden tik (1024/16 MHz) je přesně 64 ppm sekundy, takže korekce
+ // v ppm = 64 × celé tiky + zlomek. Celé tiky se přičítají každou sekundu,
+ // zlomek se rozkládá Bresenhamovým střádačem – občas se použije OCR1A o 1 větší.
+ #define T1_PERIODA  15625u  // tiky Timer1 za sekundu (16 MHz / 1024)
+ volatile int8_t  korekce_cele   = 0;  // korekce_ppm >> 6 (celé tiky za sekundu)
+ volatile uint8_t korekce_zlomek = 0;  // korekce_ppm & 63 (zlomek v 1/64 tiku)
+ #endif
+ 
+ // Vypnutý displej (klávesa * při nejnižším jasu); s RTC základnou pak
+ // CPU spí v SLEEP_MODE_PWR_SAVE a klávesnici kontroluje jednou za sekundu
+ #define BDENI_SEKUND 3       // jak dlouho zůstat vzhůru po zjištění stisku
+ uint8_t displej_vypnut = 0;
+ uint8_t bdeni_sekund   = 0;
+ 
+ // Měření kmitočtu proti vnějšímu 1PPS na ICP1 (PD6): za MERENI_PULZU sekund
+ // se napočítá T1_PERIODA × MERENI_PULZU tiků; rozdíl je přímo chyba v ppm
+ // (jen se základnou Timer1)
+ #define MERENI_PULZU    64
+ #define MERENI_NECINNE  0
+ #define MERENI_START    1   // čeká na první pulz (zapisuje main)
+ #define MERENI_BEZI     2   // zapisuje ISR
+ #define MERENI_HOTOVO   3   // zapisuje ISR
+ 
+ volatile uint8_t  mereni_stav = MERENI_NECINNE;
+ volatile uint8_t  mereni_pulzy;            // počet pulzů od začátku měření
+ volatile uint8_t  mereni_zacatek_periody;  // sekundy_isr v prvním pulzu
+ volatile uint16_t mereni_zacatek;          // ICR1 v prvním pulzu
+ volatile uint8_t  mereni_konec_periody;    // sekundy_isr v posledním pulzu
+ volatile uint16_t mereni_konec;            // ICR1 v posledním pulzu
+
+ // Synchronizace času více hodin po sběrnici TWI (SYNC v makefile): master
+ // na začátku každé minuty vyšle obecným voláním (adresa 0) rámec s časem,
+ // dnem v týdnu a datem v BCD. Slave si v okamžiku své adresy zapamatuje
+ // fázi Timer1, z ní a z rámce spočítá odchylku od mastera v tikách a tu
+ // rozloží do délky následujících sekund (nejvýše SYNC_KROK tiků za
+ // sekundu), takže sekundy na displeji nikdy necouvnou ani nepřeskočí.
+ // Skokem se srovná jen odchylka nad SYNC_SKOK_TIKU (např. po zapnutí).
+ // PC0/PC1 jsou pak vývody SCL/SDA, řádky 1 a 2 klávesnice jsou na PB6/PB7.
+ #ifdef SYNC
+ #if defined(SYNC_SLAVE) && defined(ZAKLADNA_RTC)
+ #error "SYNC=SLAVE dolaďuje fázi Timer1, vyžaduje ZAKLADNA=T1"
+ #endif
+ #define SYNC_TWBR    72     // SCL = F_CPU / (16 + 2 × TWBR) = 100 kHz
+ #define SYNC_ADRESA  0x48   // vlastní adresa slave (rámce chodí obecným voláním)
+ #define SYNC_RAMEC   7      // sekundy, minuty, hodiny, den v týdnu, den, měsíc, rok
+ #define SYNC_VOLNO   0
+ #define SYNC_VYSILA  1      // master: rámec se vysílá (zapisuje main, konec ISR)
+ #define SYNC_PRIJATO 2      // slave: celý rámec přijat (zapisuje ISR, konec main)
+
+ volatile uint8_t sync_ramec[SYNC_RAMEC];  // vysílaný (master) nebo přijatý (slave) rámec
+ volatile uint8_t sync_index = 0;          // pozice v rámci
+ volatile uint8_t sync_stav  = SYNC_VOLNO;
+ volatile uint8_t sync_chyby = 0;          // chyby sběrnice a neplatné rámce (nasycený)
+ #ifdef SYNC_SLAVE
+ #define SYNC_KROK      156                     // ~1 % sekundy – nejvyšší úprava délky sekundy
+ #define SYNC_SKOK_TIKU (2 * (int32_t)T1_PERIODA) // větší odchylka se srovná skokem
+
+ volatile uint16_t sync_faze;      // TCNT1 v okamžiku adresy rámce
+ volatile uint8_t  sync_sekundy;   // sekundy_isr v tomtéž okamžiku
+ volatile int16_t  sync_zbyva = 0; // odchylka, kterou zbývá rozložit (+ = hodiny se předbíhají)
+ uint8_t sync_skoky = 0;           // počet srovnání skokem (nasycený)
+ #endif
+ #endif
+ 
+ // Fronta událostí klávesnice (plní ISR, vybírá hlavní smyčka)
+ #define KLAV_ZADNA    99    // žádná událost / žádná klávesa
+ #define KLAV_PUSTENI  0x80  // příznak puštění klávesy (kód | KLAV_PUSTENI)
+ #define KLAV_OPAKOVANI 0x40 // příznak automatického opakování (kód | KLAV_OPAKOVANI)
+ #define KLAV_AKORD_CD 16    // událost: současný stisk C+D (rychlé odložení budíku)
+ #define KLAV_FRONTA   8     // velikost fronty (mocnina 2)
+ // převod doby [ms] na počet průchodů klávesnicí (každý řádek se čte OBNOVA_HZ×/s)
+ #define KLAV_PRUCHODU(ms) ((OBNOVA_HZ * (ms) + 999) / 1000)
+ #define KLAV_DEBOUNCE KLAV_PRUCHODU(20)   // ustálení stavu klávesy
+ // Automatické opakování držené klávesy (časovač CAS_OPAKOVANI v hlavní
+ // smyčce): po prodlevě v intervalu KLAV_OPAK, po KLAV_ZRYCHLENI
+ // opakováních v kratším intervalu KLAV_OPAK_RYCHLE [ms]
+ #define KLAV_PRODLEVA    500
+ #define KLAV_OPAK        150
+ #define KLAV_OPAK_RYCHLE 50
+ #define KLAV_ZRYCHLENI   10
+ #define KLAV_OPAK_MASKA  ((1u << 10) | (1u << 11))  // opakují se jen A a B
+ #define KLAV_AKORD_MASKA ((1u << 12) | (1u << 13))  // C+D
+ // Klávesa držená déle než KLAV_ZASEKNUTI_SEK (zkrat, špína v kontaktu) se
+ // považuje za zaseknutou: až do puštění se vyřadí z akordů i opakování
+ // a PB3 dvojitě bliká
+ #define KLAV_ZASEKNUTI_SEK 20
+ 
+ volatile uint8_t klav_fronta[KLAV_FRONTA];
+ volatile uint8_t klav_zapis = 0;  // index zápisu (mění jen ISR)
+ volatile uint8_t klav_cteni = 0;  // index čtení (mění jen hlavní smyčka)
+ uint8_t opak_klavesa = KLAV_ZADNA;  // klávesa s automatickým opakováním
+ uint8_t opak_pocet   = 0;           // počet opakování od stisku
+ volatile uint16_t klav_vadne = 0;   // zaseknuté klávesy (zapisuje main, ISR jen čte)
+ uint16_t klav_drzene  = 0;          // držené klávesy podle událostí z fronty
+ uint8_t  klav_drzeni[16];           // sekundy nepřetržitého držení každé klávesy
+ uint8_t  klav_zaseknuti = 0;        // počet zjištěných zaseknutí (nasycený)
+ 
+ // Čas v kódu BCD (horní nibble = desítky, dolní = jednotky),
+ // např. 23:59:58 = { 0x58, 0x59, 0x23 }
+ struct cas_t {
+     uint8_t sekundy;  // 0x00–0x59
+     uint8_t minuty;   // 0x00–0x59
+     uint8_t hodiny;   // 0x00–0x23
+ };
+ 
+ cas_t cas = { 0, 0, 0 };  // aktuální čas
+ uint8_t den_tydne = 0;    // 0 = pondělí … 6 = neděle
+ 
+ // Datum v kódu BCD, rok 2000 + rok (0x00–0x99); posouvá se přírůstkově
+ // s přenosem z času, nikdy se nepočítá z počtu dní
+ struct datum_t {
+     uint8_t den;      // 0x01–0x31
+     uint8_t mesic;    // 0x01–0x12
+     uint8_t rok;      // 0x00–0x99
+ };
+ 
+ datum_t datum = { 0x01, 0x01, 0x00 };
+ uint8_t pohled = POHLED_CAS;  // pohled normálního režimu
+ 
+ // Rozpracované nastavení hodin a data (REZIM_NAST_HOD a REZIM_NAST_DAT).
+ // Při vstupu do režimu se zkopíruje z běžícího času, klávesy i displej
+ // pracují jen s kopií a hodiny mezitím nerušeně běží; při odchodu
+ // z režimu se kopie převezme najednou (uprava_prevezmi).
+ struct uprava_t {
+     cas_t   cas;
+     datum_t datum;
+     uint8_t den_tydne;
+ };
+ uprava_t uprava;
+ 
+ // Minuta v týdnu (0 … MINUT_TYDNE - 1) udržovaná přírůstkově s časem;
+ // budíky se porovnávají s ní, takže kontrola je jediné 16bitové porovnání
+ #define MINUT_DNE   1440
+ #define MINUT_TYDNE (7 * MINUT_DNE)
+ uint16_t minuta_tydne = 0;
+ 
+ // Budíky: čas v BCD a maska dnů v týdnu (bit 0 = pondělí … bit 6 = neděle),
+ // bit 7 masky = budík je aktivní
+ #define BUDIKU         8
+ #define BUDIK_AKTIVNI  0x80
+ #define BUDIK_VSECHNY_DNY 0x7F
+ #define BUDIK_ZADNY    0xFFFF  // dalsi_budik: žádný aktivní budík
+ 
+ struct budik_t {
+     cas_t   cas;  // sekundy se nepoužívají
+     uint8_t dny;
+ };
+ 
+ budik_t budiky[BUDIKU];
+ uint8_t budiky_poradi[BUDIKU] = { 0, 1, 2, 3, 4, 5, 6, 7 };  // indexy budiky[] seřazené podle času
+ uint16_t dalsi_budik = BUDIK_ZADNY;  // minuta v týdnu nejbližšího budíku
+ uint8_t vybrany_budik = 0;           // budík upravovaný v režimu REZIM_NAST_BUD
+ uint8_t budik_upraven = 0;           // 1 = v režimu budíku se změnil jeho čas
+ uint8_t budik_signal  = 0;           // 0 = nevzvoní, 1 = signalizuje (zapisuje jen zvonek_udalost)
+ 
+ // Stavový automat budíku: KLID → ZVONI → ODLOZENO → ZVONI …, vyhodnocuje
+ // se jen při událostech (minuta budíku, klávesa, vypršení doby zvonění)
+ #define ZVONEK_KLID     0
+ #define ZVONEK_ZVONI    1
+ #define ZVONEK_ODLOZENO 2
+ #define ZVONEK_STAVU    3
+ 
+ #define UD_BUDIK   0   // minuta budíku nebo konec odložení
+ #define UD_ODLOZ   1   // odložení (libovolná klávesa kromě #, akord C+D)
+ #define UD_VYPNI   2   // vypnutí (# při zvonění, C+D při odložení)
+ #define UD_TICHO   3   // automatické ztišení po AUTO_TICHO_MINUT zvonění
+ #define UD_UDALOSTI 4
+ 
+ #define ODLOZENI_MINUT   5
+ #define AUTO_TICHO_MINUT 10
+ 
+ // Přechody automatu [stav][událost], uložené ve flash
+ const uint8_t zvonek_prechody[ZVONEK_STAVU][UD_UDALOSTI] PROGMEM = {
+     //  UD_BUDIK        UD_ODLOZ         UD_VYPNI      UD_TICHO
+     { ZVONEK_ZVONI, ZVONEK_KLID,     ZVONEK_KLID, ZVONEK_KLID     },  // KLID
+     { ZVONEK_ZVONI, ZVONEK_ODLOZENO, ZVONEK_KLID, ZVONEK_KLID     },  // ZVONI
+     { ZVONEK_ZVONI, ZVONEK_ODLOZENO, ZVONEK_KLID, ZVONEK_ODLOZENO },  // ODLOZENO
+ };
+ 
+ uint8_t  zvonek_stav   = ZVONEK_KLID;
+ uint8_t  zvoneni_minut = 0;            // celé minuty zvonění (pro UD_TICHO)
+ uint16_t budik_odlozen = BUDIK_ZADNY;  // minuta v týdnu odloženého zvonění
+ 
+ // Teplý restart: kopie času, data a stavu zvonění v RAM, kterou startovací
+ // kód nenuluje (.noinit). Hlavní smyčka ji obnoví po každé události; po
+ // resetu od watchdogu nebo brown‑outu se z ní (při platném CRC) hodiny
+ // rozběhnou se správným časem místo 00:00. Po zapnutí napájení je obsah
+ // náhodný a CRC nesedí. Čítače příčin resetu přežijí každý reset s platnou
+ // kopií.
+ #define RESET_ZAPNUTI  0   // zapnutí napájení (PORF)
+ #define RESET_EXTERNI  1   // vývod RESET (EXTRF)
+ #define RESET_BROWNOUT 2   // pokles napájení (BORF, fuse BODEN)
+ #define RESET_WATCHDOG 3   // zaseknutý program (WDRF)
+ #define RESET_PRICIN   4
+ #define WDT_TIMEOUT    WDTO_2S  // hlavní smyčka běží nejméně jednou za sekundu
+ 
+ struct tepla_kopie_t {
+     cas_t    cas;
+     datum_t  datum;
+     uint8_t  den_tydne;
+     uint8_t  zvonek_stav;
+     uint16_t budik_odlozen;
+     uint8_t  resety[RESET_PRICIN];  // počty resetů podle příčiny (nasycené)
+     uint16_t crc;                   // CRC‑16 přes předchozí položky
+ };
+ 
+ tepla_kopie_t tepla_kopie __attribute__((section(".noinit")));
+ uint8_t restart_teply = 0;   // 1 = poslední start obnovil čas z tepla_kopie
+ 
+ // Systémový tik 1 ms odvozený z ISR multiplexu: každý slot číslice přičte
+ // celé ms své skutečné délky (MUX_PERIODA tiků Timer0, tedy zaokrouhlené
+ // 1/MUX_HZ) a zlomek v cyklech CPU se střádá, takže tiky dlouhodobě
+ // odpovídají krystalu. Hlavní smyčka musí tiky dohnat do 255 ms.
+ #define SLOT_CYKLU   (MUX_PERIODA * MUX_PREDDELICKA)  // délka slotu v cyklech CPU
+ #define MS_CYKLU     (F_CPU / 1000)                   // cyklů CPU za 1 ms
+ #define TIK_ZA_SLOT  (SLOT_CYKLU / MS_CYKLU)   // celé ms za slot
+ #define TIK_ZBYTEK   (SLOT_CYKLU % MS_CYKLU)   // zlomek ms za slot v cyklech CPU
+ volatile uint8_t tiky_isr = 0;  // čítač tiků mod 256 (zapisuje jen ISR)
+ uint8_t  tiky_zpracovane  = 0;  // tiky zpracované hlavní smyčkou
+ uint16_t tik              = 0;  // čas hlavní smyčky v ms (mod 65536)
+ 
+ // Softwarové časovače v kole o KOLO_SLOTU slotech: běžící časovač leží
+ // ve slotu (vypršení mod KOLO_SLOTU) ve dvojitě zřetězeném seznamu, takže
+ // spuštění i zastavení je O(1) a za tik se projde jen jediný slot.
+ // Obsluhy běží v hlavní smyčce, nejdelší doba je 65535 ms.
+ #define CAS_KROK      0     // krok rytmu bzučáku a vzorů LED (KROK_MS)
+ #define CAS_OPAKOVANI 1     // automatické opakování držené klávesy
+ #define CAS_ULOZENI   2     // odložené uložení nastavení do EEPROM
+ #define CAS_ZPRAVA    3     // posun dlouhé zprávy na displeji
+ #ifdef SVETLO
+ #define CAS_SVETLO    4     // odečet okolního světla pro automatický jas
+ #define CASOVACU      5
+ #else
+ #define CASOVACU      4
+ #endif
+ #define CASOVAC_ZADNY 0xFF
+ #define KOLO_SLOTU    32    // mocnina 2
+ 
+ struct casovac_t {
+     uint16_t vyprseni;   // tik vypršení
+     uint16_t perioda;    // 0 = jednorázový časovač
+     uint8_t  dalsi;      // další časovač ve stejném slotu
+     uint8_t  predchozi;  // předchozí časovač ve slotu (CASOVAC_ZADNY = první)
+     uint8_t  bezi;       // 1 = časovač je v kole
+ };
+ 
+ casovac_t casovace[CASOVACU];
+ uint8_t   kolo[KOLO_SLOTU];     // první časovač každého slotu
+ uint8_t   casovacu_bezi = 0;    // počet běžících časovačů
+ 
+ // Bzučák: tón generuje hardwarově výstup compare volného časovače
+ // (Timer2/OC2 na PD7 se základnou Timer1, Timer1/OC1A na PD5 s RTC),
+ // CPU jen zapíná a vypíná tón po krocích KROK_MS podle rytmu zvonění
+ #define BZUCAK_HZ    2000   // kmitočet tónu
+ #define KROK_MS      125    // délka jednoho kroku rytmu (časovač CAS_KROK)
+ #define RYTMUS_KROKU 8      // jeden rytmus = 8 kroků = 1 s
+ #define URGENCI      4
+ 
+ // Rytmus zvonění pro každý stupeň naléhavosti (bit 0 = první krok, 1 = tón),
+ // uložený ve flash
+ const uint8_t rytmus[URGENCI] PROGMEM = {
+     0b00000011,  // jedno krátké pípnutí za sekundu
+     0b00110011,  // dvojité pípnutí
+     0b01010101,  // rychlé pípání
+     0b01111111,  // téměř nepřetržitý tón
+ };
+ // Sekunda zvonění, od které platí další stupeň naléhavosti
+ const uint8_t urgence_od[URGENCI - 1] PROGMEM = { 30, 60, 120 };
+ 
+ uint8_t rytmus_krok        = 0;  // pozice v rytmu bzučáku
+ uint8_t rytmus_vzor        = 0;  // zbytek vzoru rytmu (bit 7 = aktuální krok)
+ uint8_t zvoneni_sekund     = 0;  // jak dlouho budík zvoní (nasycené na 255)
+ uint8_t bzucak_zapnut      = 0;
+ 
+ #ifdef ZAKLADNA_RTC
+ // Timer1, předdělička 8: 2 MHz / (2 × BZUCAK_HZ)
+ #define BZUCAK_OCR ((F_CPU / 8 / 2 + BZUCAK_HZ / 2) / BZUCAK_HZ - 1)
+ #define BZUCAK_CS  (1 << CS11)
+ #else
+ // Timer2, předdělička 32: 500 kHz / (2 × BZUCAK_HZ)
+ #define BZUCAK_OCR ((F_CPU / 32 / 2 + BZUCAK_HZ / 2) / BZUCAK_HZ - 1)
+ #define BZUCAK_CS  ((1 << CS21) | (1 << CS20))
+ #endif
+ 
+ #ifdef PROFIL
+ // Profilování (PROFIL v makefile): časovač bzučáku běží stále a jeho TCNT
+ // spolu s čítačem shod (prof_preteceni) tvoří hodiny s krokem PROF_CYKLU_TIK
+ // cyklů CPU. Délky ISR se měří jen z TCNT (jsou kratší než jedna perioda
+ // časovače, tj. 1/(2 × BZUCAK_HZ)), průchody smyčkou a zpoždění kláves
+ // z celého čítače.
+ #define BZUCAK_KLID_CS BZUCAK_CS  // časovač běží i bez tónu
+ #ifdef ZAKLADNA_RTC
+ #define PROF_TCNT       TCNT1
+ #define PROF_SHODA_VECT TIMER1_COMPA_vect
+ #define PROF_SHODA_CEKA (TIFR & (1 << OCF1A))
+ #define PROF_CYKLU_TIK  8
+ #else
+ #define PROF_TCNT       TCNT2
+ #define PROF_SHODA_VECT TIMER2_COMP_vect
+ #define PROF_SHODA_CEKA (TIFR & (1 << OCF2))
+ #define PROF_CYKLU_TIK  32
+ #endif
+ #define PROF_MODUL (BZUCAK_OCR + 1)  // tiky v jedné periodě časovače
+ 
+ // Statistika délky jednoho přerušení v tikách
+ struct prof_t {
+     uint16_t min;
+     uint16_t max;
+     uint32_t soucet;
+     uint16_t pocet;
+ };
+ #define PROF_MUX      0  // ISR(TIMER0_COMP_vect)
+ #define PROF_ZAKLADNA 1  // ISR časové základny
+ #define PROF_ISR      2
+ 
+ // Histogramy: koš k počítá délky 2^(bit+k−1) až 2^(bit+k) cyklů, koš 0
+ // vše kratší, poslední koš vše delší
+ #define PROF_KOSU        8
+ #define PROF_SMYCKA_BIT  7   // průchod smyčkou: < 128 … ≥ 8192 cyklů
+ #define PROF_KLAVESA_BIT 9   // stisk → akce:    < 512 … ≥ 32768 cyklů
+ 
+ prof_t   prof_isr[PROF_ISR];
+ volatile uint32_t prof_preteceni = 0;
+ uint16_t prof_smycka[PROF_KOSU];     // histogram délky průchodu hlavní smyčkou
+ uint16_t prof_klavesa[PROF_KOSU];    // histogram zpoždění vložení klávesy → obsluha
+ uint32_t klav_cas[KLAV_FRONTA];      // čas vložení událostí ve frontě klávesnice
+ uint32_t prof_klav_cas;              // čas vložení právě obsluhované události
+ uint8_t  prof_stranka = 0;           // diagnostická stránka na displeji
+ #else
+ #define BZUCAK_KLID_CS 0          // bez tónu časovač stojí
+ #endif
+ 
+ // Mapa klávesnice 4×4: index podle aktivního
+ // řádku (0–3) a detekovaného sloupce (0–3), uložená ve flash
+ const uint8_t mapa_klaves[4][4] PROGMEM = {
+     {  1,  4,  7, 14 },  // |(S13) 1|(S14) 4|(S15) 7|(S16) *|
+     {  2,  5,  8,  0 },  // |(S9)  2|(S10) 5|(S11) 8|(S12) 0|
+     {  3,  6,  9, 15 },  // |(S5)  3|(S6)  6|(S7)  9|(S8)  #|
+     { 10, 11, 12, 13 }   // |(S1)  A|(S2)  B|(S3)  C|(S4)  D|
+ };
+ 
+ // --- Deska: porty a polarita vývodů ---
+ // Každý port je typ se statickými přístupy k registrům; po rozvinutí
+ // inline funkcí zbude stejná instrukce in/out/sbi jako při přímém zápisu
+ // PORTx. Skupina vývodů (vyvody<>) nese masku a aktivní úroveň, převod
+ // logického stavu (1 = aktivní) na úroveň vývodů se vyhodnotí při překladu.
+ #define DESKA_PORT(x)                                                 \
+     struct port_##x {                                                 \
+         static inline volatile uint8_t &port(void) { return PORT##x; } \
+         static inline volatile uint8_t &ddr(void)  { return DDR##x; }  \
+         static inline volatile uint8_t &pin(void)  { return PIN##x; }  \
+     };
+ DESKA_PORT(A)
+ DESKA_PORT(B)
+ DESKA_PORT(C)
+ DESKA_PORT(D)
+ #undef DESKA_PORT
+ 
+ template <class Port, uint8_t Maska, bool AktivniNula>
+ struct vyvody {
+     typedef Port port;
+ 
+     // úroveň vývodů skupiny, v níž jsou aktivní právě 'bity'
+     static constexpr uint8_t uroven(uint8_t bity) {
+         return AktivniNula ? (uint8_t)(~bity & Maska) : (uint8_t)(bity & Maska);
+     }
+     // k úrovni 'u' přidá aktivní 'bity' (rozsvícení segmentu, LED …)
+     static constexpr uint8_t aktivuj(uint8_t u, uint8_t bity) {
+         return AktivniNula ? (uint8_t)(u & ~bity) : (uint8_t)(u | bity);
+     }
+     static inline void vystup(void) {
+         Port::ddr() |= Maska;
+     }
+     // zápis úrovně skupiny, ostatní vývody portu beze změny
+     static inline void zapis(uint8_t u) {
+         Port::port() = (Port::port() & ~Maska) | u;
+     }
+     // zápis celého portu: aktivní 'bity' (podmnožina masky), ostatní
+     // vývody v log.1 (pull‑up vstupů, periferie si vývod převezmou samy)
+     static inline void zapis_port(uint8_t bity) {
+         Port::port() = AktivniNula ? (uint8_t)~bity : (uint8_t)(bity | (uint8_t)~Maska);
+     }
+ };
+ 
+ // Masky pro výběr pozice 1.–4. číslice při multiplexování (také výběr
+ // řádku klávesnice), uložené ve flash
+ const uint8_t poz[] PROGMEM = { 1, 2, 4, 8 };
+ 
+ // Výběr pozice displeje na PORTD. S konzolí jsou PD0/PD1 vývody RXD/TXD
+ // USART, pozice se proto posunou na volné vývody PORTD (mimo ICP1/OC2,
+ // resp. OC1A s RTC základnou).
+ #if !defined(KONZOLE)
+ #define poz_displej poz
+ #define DISPLEJ_DDRD 0x0F
+ #elif defined(ZAKLADNA_RTC)
+ const uint8_t poz_displej[] PROGMEM = { 1 << PD2, 1 << PD3, 1 << PD4, 1 << PD6 };
+ #define DISPLEJ_DDRD ((1 << PD2) | (1 << PD3) | (1 << PD4) | (1 << PD6))
+ #else
+ const uint8_t poz_displej[] PROGMEM = { 1 << PD2, 1 << PD3, 1 << PD4, 1 << PD5 };
+ #define DISPLEJ_DDRD ((1 << PD2) | (1 << PD3) | (1 << PD4) | (1 << PD5))
+ #endif
+ 
+ // S automatickým jasem (SVETLO) je PA7/ADC7 vstupem fotorezistoru místo
+ // segmentu tečky; úroveň segmentů pak bit 7 nikdy nenastaví (vstup bez
+ // pull‑upu) a tečky ani dvojtečka se nezobrazují
+ #ifdef SVETLO
+ #define SEGMENTY_MASKA 0x7F
+ #else
+ #define SEGMENTY_MASKA 0xFF
+ #endif
+ 
+ // Deska A: displej se společnou anodou (segment svítí v log.0, pozice
+ // spíná PNP tranzistor v log.0), LED proti napájení; odpovídá zapojení
+ // v Debug/a32.sim1 (společná katoda za invertujícími budiči)
+ struct deska_a {
+     typedef vyvody<port_A, SEGMENTY_MASKA, true> segmenty;
+     typedef vyvody<port_D, DISPLEJ_DDRD, true>   pozice;
+     typedef vyvody<port_B, 0x0F, true>           led;        // PB0–PB3
+     typedef port_C                               klavesnice; // řádky PC0–PC3, sloupce PC4–PC7
+     typedef port_B                               klavesnice_rtc;  // sloupce 3 a 4 na PB4/PB5 (RTC)
+     typedef port_B                               klavesnice_sync; // řádky 1 a 2 na PB6/PB7 (SYNC)
+     static constexpr uint8_t svetlo_kanal = 7;   // fotorezistor na ADC7/PA7 (SVETLO)
+ };
+ 
+ // Deska B: displej se společnou katodou buzený přímo (segment svítí
+ // v log.1, pozice spíná NPN tranzistor v log.1), LED proti zemi
+ struct deska_b {
+     typedef vyvody<port_A, SEGMENTY_MASKA, false> segmenty;
+     typedef vyvody<port_D, DISPLEJ_DDRD, false>   pozice;
+     typedef vyvody<port_B, 0x0F, false>           led;
+     typedef port_C                                klavesnice;
+     typedef port_B                                klavesnice_rtc;
+     typedef port_B                                klavesnice_sync;
+     static constexpr uint8_t svetlo_kanal = 7;
+ };
+ 
+ // Deska se volí při překladu (DESKA v Makefile)
+ #ifdef DESKA_B
+ typedef deska_b deska;
+ #else
+ typedef deska_a deska;
+ #endif
+ 
+ // LED indikace PB0–PB3: každá LED má vzor na dvě sekundy po krocích rytmu
+ // (bit vzoru = stav_led × 8 + krok od začátku sekundy). Vzory se vybírají
+ // jen po událostech, posouvají je kroky rytmu (časovač CAS_KROK) a PORTB
+ // se zapíše jen tehdy, když se úroveň některé LED opravdu změní.
+ #define LED_ZHASNUTA 0
+ #define LED_SVITI    1
+ #define LED_BLIK     2   // svítí se stav_led (1 s svit, 1 s tma)
+ #define LED_RYCHLE   3   // rychlé blikání 4 Hz – chyba
+ #define LED_DVOJBLIK 4   // dvě krátká bliknutí za sekundu – odložený budík
+ #define LED_VZORU    5
+ #define LED_POCET    4   // index LED = bit PORTB
+ #define LED_KROKOVY(v) ((v) >= LED_RYCHLE)  // vzor se mění i mezi sekundami
+ 
+ const uint16_t led_vzory[LED_VZORU] PROGMEM = {
+     0x0000,  // zhasnutá
+     0xFFFF,  // svítí
+     0xFF00,  // blikání se stav_led
+     0x5555,  // rychlé blikání
+     0x0505,  // dvojité bliknutí
+ };
+ 
+ uint8_t led_vzor[LED_POCET];  // vybraný vzor každé LED
+ uint8_t led_faze    = 0;      // krok rytmu od začátku sekundy (nasycený na 7)
+ uint8_t led_kroky   = 0;      // 1 = některý vzor potřebuje kroky rytmu
+ uint8_t led_obnovit = 1;      // 1 = úroveň LED je třeba přepočítat
+ uint8_t led_uroven  = deska::led::uroven(0);  // naposledy zapsaná úroveň LED
+ 
+ // Segmenty 7‑segmentu (bit na PORTA)
+ //      a
+ //    f   b
+ //      g
+ //    e   c
+ //      d   dp
+ #define SEG_A  (1 << 0)
+ #define SEG_B  (1 << 1)
+ #define SEG_C  (1 << 2)
+ #define SEG_D  (1 << 3)
+ #define SEG_E  (1 << 4)
+ #define SEG_F  (1 << 5)
+ #define SEG_G  (1 << 6)
+ #define SEG_DP (1 << 7)
+ 
+ // Indexy znaků nad rámec číslic 0–9 a A–F (index = hodnota číslice)
+ #define ZNAK_MEZERA  16
+ #define ZNAK_POMLCKA 17
+ #define ZNAK_H       18
+ #define ZNAK_L       19
+ #define ZNAK_N       20  // malé n
+ #define ZNAK_O       21  // malé o
+ #define ZNAK_P       22
+ #define ZNAK_R       23  // malé r
+ #define ZNAK_T       24  // malé t
+ #define ZNAK_U       25
+ 
+ // Znaky na 7‑segmentu jako množiny rozsvícených segmentů (logická
+ // úroveň, polaritu desky doplní až zveřejnění snímku), uložené ve flash
+ const uint8_t znaky[] PROGMEM = {
+     SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F,          // 0
+     SEG_B | SEG_C,                                          // 1
+     SEG_A | SEG_B | SEG_D | SEG_E | SEG_G,                  // 2
+     SEG_A | SEG_B | SEG_C | SEG_D | SEG_G,                  // 3
+     SEG_B | SEG_C | SEG_F | SEG_G,                          // 4
+     SEG_A | SEG_C | SEG_D | SEG_F | SEG_G,                  // 5
+     SEG_A | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G,          // 6
+     SEG_A | SEG_B | SEG_C | SEG_F,                          // 7
+     SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G,  // 8
+     SEG_A | SEG_B | SEG_C | SEG_F | SEG_G,                  // 9
+     SEG_A | SEG_B | SEG_C | SEG_E | SEG_F | SEG_G,          // A
+     SEG_C | SEG_D | SEG_E | SEG_F | SEG_G,                  // b
+     SEG_D | SEG_E | SEG_G,                                  // c
+     SEG_B | SEG_C | SEG_D | SEG_E | SEG_G,                  // d
+     SEG_A | SEG_D | SEG_E | SEG_F | SEG_G,                  // E
+     SEG_A | SEG_E | SEG_F | SEG_G,                          // F
+     0,                                                      // mezera
+     SEG_G,                                                  // -
+     SEG_B | SEG_C | SEG_E | SEG_F | SEG_G,                  // H
+     SEG_D | SEG_E | SEG_F,                                  // L
+     SEG_C | SEG_E | SEG_G,                                  // n
+     SEG_C | SEG_D | SEG_E | SEG_G,                          // o
+     SEG_A | SEG_B | SEG_E | SEG_F | SEG_G,                  // P
+     SEG_E | SEG_G,                                          // r
+     SEG_D | SEG_E | SEG_F | SEG_G,                          // t
+     SEG_B | SEG_C | SEG_D | SEG_E | SEG_F                   // U
+ };
+ 
+ // Čtení vzoru znaku z flash
+ static inline uint8_t znak(uint8_t z) {
+     return pgm_read_byte(&znaky[z]);
+ }
+ 
+ // Zkratky dnů v týdnu (indexy znaků), pondělí … neděle, uložené ve flash
+ const uint8_t den_zkratka[7][2] PROGMEM = {
+     { ZNAK_P, ZNAK_O }, { ZNAK_U, ZNAK_T }, { 5, ZNAK_T }, { 12, ZNAK_T },
+     { ZNAK_P, 10 },     { 5, ZNAK_O },      { ZNAK_N, 14 }
+ };
+ 
+ // OCR0 fáze svitu pro jednotlivé úrovně jasu 0–15, uložené ve flash
+ const uint8_t jas_svit[JAS_UROVNI] PROGMEM = {
+     JAS_OCR(0),  JAS_OCR(1),  JAS_OCR(2),  JAS_OCR(3),
+     JAS_OCR(4),  JAS_OCR(5),  JAS_OCR(6),  JAS_OCR(7),
+     JAS_OCR(8),  JAS_OCR(9),  JAS_OCR(10), JAS_OCR(11),
+     JAS_OCR(12), JAS_OCR(13), JAS_OCR(14), JAS_OCR(15)
+ };
+ 
+ uint8_t jas = JAS_UROVNI - 1;  // aktuální úroveň jasu (klávesy * a #)
+ 
+ // Trvalé nastavení v EEPROM – kruh NAST_SLOTU slotů, každé uložení jde do
+ // dalšího slotu (rozložení opotřebení). Platný slot má správné CRC,
+ // nejnovější je ten s nejvyšším pořadovým číslem (porovnání mod 256).
+ struct nastaveni_t {
+     budik_t budiky[BUDIKU];
+     uint8_t jas;
+     int16_t korekce_ppm;
+ };
+ 
+ struct nast_slot_t {
+     uint8_t     sekvence;  // pořadové číslo uložení
+     nastaveni_t data;
+     uint16_t    crc;       // CRC‑16 přes sekvenci a data, zapisuje se poslední
+ };
+ 
+ #define NAST_SLOTU       8
+ #define NAST_ODKLAD_MS   10000  // uložení jasu až po 10 s bez další změny
+ #define NAST_ZNOVU_MS    50     // nový pokus, dokud běží předchozí zápis
+ 
+ nast_slot_t ee_nastaveni[NAST_SLOTU] EEMEM;
+ 
+ nastaveni_t nast_ulozene;          // kopie naposledy uloženého nastavení
+ uint8_t     nast_slot     = NAST_SLOTU - 1;  // slot posledního uložení
+ uint8_t     nast_sekvence = 0;     // pořadové číslo posledního uložení
+ uint8_t     nast_poskozeno = 0;    // 1 = EEPROM obsahuje zápis, ale žádný platný slot
+
+ // Kopie stavu nastavení pro teplý restart (.noinit, vlastní CRC): mění se
+ // jen při načtení a uložení nastavení, takže se po resetu od watchdogu
+ // nebo brown‑outu nemusí znovu procházet sloty EEPROM
+ struct nast_tepla_t {
+     nastaveni_t data;       // nast_ulozene
+     uint8_t     slot;       // nast_slot
+     uint8_t     sekvence;   // nast_sekvence
+     uint8_t     poskozeno;  // nast_poskozeno
+     uint16_t    crc;        // CRC‑16 přes předchozí položky
+ };
+
+ nast_tepla_t nast_tepla __attribute__((section(".noinit")));
+ 
+ // Zápis slotu na pozadí v ISR(EE_RDY_vect); hlavní smyčka buffer a ukazatele
+ // nastaví jen tehdy, když je přerušení EEPROM vypnuté (ee_zbyva == 0)
+ nast_slot_t      ee_buffer;
+ const uint8_t   *ee_data;
+ uint16_t         ee_adresa;        // adresa dalšího zapisovaného bajtu v EEPROM
+ volatile uint8_t ee_zbyva = 0;     // počet bajtů zbývajících k zápisu
+ 
+ #ifdef ZAZNAM
+ // Záznam událostí pro diagnostiku z provozu. Čtyřbajtové záznamy jdou
+ // nejdřív do kruhu v RAM (.noinit, přežije teplý restart) a po dávkách
+ // ZAZ_DAVKA se na pozadí zapisují do kruhu v EEPROM (sdílí zápis s
+ // nastavením). Události nesou odstup v ms od předchozí události (tik);
+ // po ZAZ_ZNACKA_SEK bez události se před další vloží značka ZAZ_CAS
+ // s absolutním časem. Vypisuje se příkazem LOG konzole, simulace ho
+ // umí přehrát (make prehraj).
+ struct zaznam_t {
+     uint8_t  typ;      // ZAZ_* | index budíku << ZAZ_INDEX | fáze kruhu EEPROM
+     uint8_t  data;
+     uint16_t hodnota;  // odstup v ms, u ZAZ_CAS minuta týdne, u ZAZ_BUDIK čas
+ };
+ 
+ #define ZAZ_CAS      0    // data = sekundy (BCD), hodnota = minuta_tydne
+ #define ZAZ_RESET    1    // data = příčina RESET_* | teplý restart << 7
+ #define ZAZ_KLAVESA  2    // data = událost z fronty klávesnice, hodnota = odstup
+ #define ZAZ_REZIM    3    // data = nový rezim_nastaveni, hodnota = odstup
+ #define ZAZ_ZVONEK   4    // data = UD_* << 4 | nový stav ZVONEK_*, hodnota = odstup
+ #define ZAZ_BUDIK    5    // data = dny, hodnota = hodiny << 8 | minuty (BCD)
+ #define ZAZ_TYP      0x0F
+ #define ZAZ_INDEX    4    // posun indexu budíku v typ
+ #define ZAZ_FAZE     0x80 // střídá se po každém oběhu kruhu EEPROM
+ #define ZAZ_PRAZDNY  0xFF // smazaná EEPROM
+ 
+ #define ZAZ_RAM        16   // kruh v RAM (mocnina 2, dvě dávky)
+ #define ZAZ_DAVKA      8    // záznamů v jednom zápisu do EEPROM
+ #define ZAZ_EEPROM     128  // kruh v EEPROM (násobek ZAZ_DAVKA)
+ #define ZAZ_DAVEK      (ZAZ_EEPROM / ZAZ_DAVKA)
+ #define ZAZ_ZNACKA_SEK 60   // nejdelší odstup v sekundách (ms se vejdou do 16 bitů)
+ 
+ zaznam_t ee_zaznam[ZAZ_EEPROM] EEMEM;
+ 
+ struct zaznam_ram_t {
+     zaznam_t zaznamy[ZAZ_RAM];
+     uint8_t  zapis;     // počet vložených záznamů (mod 256)
+     uint8_t  ulozeno;   // počet záznamů zapsaných do EEPROM (mod 256, po dávkách)
+     uint8_t  kontrola;  // zapis ^ ulozeno ^ ZAZ_KONTROLA – platnost po resetu
+ };
+ #define ZAZ_KONTROLA 0xA5
+ 
+ zaznam_ram_t zaz_ram __attribute__((section(".noinit")));
+ uint8_t  zaz_davka    = 0;     // dávka kruhu EEPROM, která se zapíše příště
+ uint8_t  zaz_faze     = 0;     // fáze zapisovaných dávek (ZAZ_FAZE nebo 0)
+ uint8_t  zaz_zapisuje = 0;     // 1 = dávka se zapisuje v ISR(EE_RDY_vect)
+ uint8_t  zaz_ztraty   = 0;     // záznamy zahozené při plném kruhu v RAM (nasycené)
+ uint16_t zaz_tik      = 0;     // tik poslední události
+ uint8_t  zaz_sekund   = ZAZ_ZNACKA_SEK;  // sekundy od ní (nasycené)
+ uint8_t  zaz_rezim    = REZIM_NORMAL;    // naposledy zaznamenaný režim
+ uint8_t  zaz_vypis    = 0;     // výpis LOG: 0 = neběží, jinak pozice + 1
+ 
+ void zaznam_pis(uint8_t typ, uint8_t data);
+ #define ZAZ_UDALOST(typ, data) zaznam_pis(typ, data)
+ #else
+ #define ZAZ_UDALOST(typ, data)
+ #endif
+ 
+ #ifdef KONZOLE
+ // Sériová konzole (USART 8N1, U2X): příjem i vysílání přes kruhové
+ // buffery v přerušení. Přijatý řádek se parsuje přímo v konz_rx[]
+ // a teprve potom se jeho místo uvolní (konz_rx_cteni).
+ #ifndef KONZOLE_BAUD
+ #define KONZOLE_BAUD 9600
+ #endif
+ #define KONZ_UBRR ((F_CPU / 8 + KONZOLE_BAUD / 2) / KONZOLE_BAUD - 1)
+ #define KONZ_RX 64          // velikost přijímacího bufferu (mocnina 2)
+ #define KONZ_TX 256         // velikost vysílacího bufferu (mocnina 2, nejvýše 256)
+ #define KONZ_KONEC   '\n'   // konec řádku v konz_rx[]
+ #define KONZ_PRETEKL 0      // konec zkráceného řádku (buffer byl plný)
+ 
+ volatile uint8_t konz_rx[KONZ_RX];
+ volatile uint8_t konz_rx_zapis = 0;  // mění jen ISR
+ volatile uint8_t konz_rx_cteni = 0;  // mění jen hlavní smyčka (po zpracování řádku)
+ volatile uint8_t konz_radky    = 0;  // počet přijatých řádků (mění jen ISR)
+ uint8_t konz_radky_zpracovane  = 0;
+ uint8_t konz_i;                      // pozice parseru v konz_rx[]
+ 
+ volatile uint8_t konz_tx[KONZ_TX];
+ volatile uint8_t konz_tx_zapis = 0;  // mění jen hlavní smyčka
+ volatile uint8_t konz_tx_cteni = 0;  // mění jen ISR
+ 
+ // statistiky pro příkaz STATS
+ uint16_t konz_prikazy = 0;           // zpracované řádky
+ uint16_t konz_chyby   = 0;           // odmítnuté řádky
+ volatile uint8_t konz_rx_ztraty = 0; // zahozené přijaté znaky
+ uint8_t  konz_tx_ztraty = 0;         // zahozené odesílané znaky
+ uint16_t provoz_hodin   = 0;
+ #endif
+ 
+ // Snímek displeje: segmentové vzory a jas (OCR0 svitu) 1.–4. pozice
+ // (0 = jednotky minut … 3 = desítky hodin), připravené hlavní smyčkou,
+ // ISR je jen vypisuje.
+ struct snimek_t {
+     uint8_t segmenty[4];
+     uint8_t svit[4];
+ };
+ 
+ // Trojitý buffer snímků: hlavní smyčka píše do bufferu, který není
+ // zveřejněný ani právě čtený, a pak jediným zápisem bajtu zveřejní jeho
+ // index. ISR si index převezme vždy na začátku snímku, takže všechny
+ // 4 číslice pocházejí z jednoho snímku. První snímek zveřejní main()
+ // ještě před povolením přerušení.
+ volatile snimek_t displej[3];
+ volatile uint8_t displej_zverejneny = 0;  // index posledního hotového bufferu (zapisuje main)
+ volatile uint8_t displej_cteny      = 0;  // index bufferu právě vypisovaného ISR (zapisuje ISR)
+ 
+ // Obraz displeje skládaný hlavní smyčkou: logické segmenty (1 = svítí)
+ // pozic 0 (vpravo) … 3 a masky blikání. Fáze blikání (stav_led), polaritu
+ // desky a jas doplní až zveřejnění snímku, takže změna fáze obraz znovu
+ // neskládá a ISR nepřibude žádná práce.
+ #define POZICE_DVOJTECKA 2   // tečka jednotek hodin slouží jako dvojtečka HH.MM
+ uint8_t obraz[4];
+ uint8_t obraz_blik  = 0;     // maska pozic, které zhasínají se stav_led
+ uint8_t obraz_tecky = 0;     // maska pozic, jejichž tečka bliká se stav_led
+ 
+ // Zpráva na displeji (např. „AL 3“ po výběru budíku) – zobrazí se místo
+ // času na ZPRAVA_SEKUND sekund; znaky (segmenty) zleva doprava. Zpráva
+ // delší než 4 znaky nejprve ZPRAVA_PRODLEVA ms stojí, pak se po ZPRAVA_POSUN
+ // ms posouvá doleva (časovač CAS_ZPRAVA) a ZPRAVA_SEKUND stojí její konec.
+ #define ZPRAVA_SEKUND   2
+ #define ZPRAVA_MAX      12
+ #define ZPRAVA_PRODLEVA 1000
+ #define ZPRAVA_POSUN    250
+ uint8_t zprava[ZPRAVA_MAX];
+ uint8_t zprava_delka  = 0;
+ uint8_t zprava_posun  = 0;   // index znaku na levém okraji displeje
+ uint8_t zprava_sekund = 0;   // nenulové = zpráva se zobrazuje
+ 
+ /*
+  * Funkce: bcd_inc
+  * ---------------
+  * Zvýší BCD hodnotu o 1 – při přetečení jednotek (0x?A) přičte 6,
+  * čímž přenese do desítek. Bez dělení.
+  */
+ static inline uint8_t bcd_inc(uint8_t v) {
+     v++;
+     if ((v & 0x0F) == 0x0A) {
+         v += 6;
+     }
+     return v;
+ }
+ 
+ /*
+  * Funkce: cas_tick
+  * ----------------
+  * Posune čas o jednu sekundu s řetězeným přenosem sekundy → minuty → hodiny.
+  *
+  * Návrat: 0 = beze změny minuty, CAS_MINUTA = změnila se minuta (je třeba
+  *         překreslit displej), CAS_MINUTA | CAS_DEN = navíc začal nový den
+  */
+ #define CAS_MINUTA 1
+ #define CAS_DEN    2
+ 
+ uint8_t cas_tick(cas_t *c) {
+     c->sekundy = bcd_inc(c->sekundy);
+     if (c->sekundy != 0x60) {
+         return 0;
+     }
+     c->sekundy = 0;
+     c->minuty = bcd_inc(c->minuty);
+     if (c->minuty == 0x60) {
+         c->minuty = 0;
+         c->hodiny = bcd_inc(c->hodiny);
+         if (c->hodiny == 0x24) {
+             c->hodiny = 0;
+             return CAS_MINUTA | CAS_DEN;
+         }
+     }
+     return CAS_MINUTA;
+ }
+ 
+ /*
+  * Funkce: cas_pricti_hodinu / cas_pricti_minutu
+  * ---------------------------------------------
+  * Inkrementace jednoho pole při nastavování (00–23, resp. 00–59),
+  * bez přenosu do vyššího pole.
+  */
+ void cas_pricti_hodinu(cas_t *c) {
+     c->hodiny = bcd_inc(c->hodiny);
+     if (c->hodiny == 0x24) {
+         c->hodiny = 0;
+     }
+ }
+ 
+ void cas_pricti_minutu(cas_t *c) {
+     c->minuty = bcd_inc(c->minuty);
+     if (c->minuty == 0x60) {
+         c->minuty = 0;
+     }
+ }
+ 
+ /*
+  * Funkce: cas_zadej_cislici
+  * -------------------------
+  * Přímé zadání jedné číslice času na pozici 0–3 (zleva: desítky hodin,
+  * jednotky hodin, desítky minut, jednotky minut). Číslice, se kterou by
+  * čas nebyl platný, se odmítne; po zadání desítek hodin 2 se jednotky
+  * omezí na 3.
+  * Návrat: 1 = číslice přijata, 0 = odmítnuta
+  */
+ uint8_t cas_zadej_cislici(cas_t *c, uint8_t pozice, uint8_t cislice) {
+     switch (pozice) {
+     case 0:
+         if (cislice > 2) {
+             return 0;
+         }
+         c->hodiny = (cislice << 4) | (c->hodiny & 0x0F);
+         if (c->hodiny > 0x23) {
+             c->hodiny = 0x23;
+         }
+         break;
+     case 1:
+         if ((c->hodiny >> 4) == 2 && cislice > 3) {
+             return 0;
+         }
+         c->hodiny = (c->hodiny & 0xF0) | cislice;
+         break;
+     case 2:
+         if (cislice > 5) {
+             return 0;
+         }
+         c->minuty = (cislice << 4) | (c->minuty & 0x0F);
+         break;
+     default:
+         c->minuty = (c->minuty & 0xF0) | cislice;
+         break;
+     }
+     return 1;
+ }
+ 
+ // Počet dní v měsících (BCD), únor bez přestupného dne, uložený ve flash
+ const uint8_t mesic_dni[12] PROGMEM = {
+     0x31, 0x28, 0x31, 0x30, 0x31, 0x30, 0x31, 0x31, 0x30, 0x31, 0x30, 0x31
+ };
+ 
+ /*
+  * Funkce: datum_dni
+  * -----------------
+  * Počet dní měsíce data d (BCD). Rok je přestupný, je-li dělitelný 4
+  * (pro 2000–2099 bez výjimek); v BCD to platí, když jednotky plus
+  * 2 × lichost desítek dají násobek 4 – bez převodu a dělení.
+  */
+ uint8_t datum_dni(const datum_t *d) {
+     uint8_t m = d->mesic;
+     if (m >= 0x10) {
+         m -= 6;    // BCD 0x10–0x12 → 10–12
+     }
+     if (m == 2 && ((((d->rok >> 3) & 2) + (d->rok & 0x0F)) & 3) == 0) {
+         return 0x29;
+     }
+     return pgm_read_byte(&mesic_dni[m - 1]);
+ }
+ 
+ /*
+  * Funkce: datum_dalsi_den
+  * -----------------------
+  * Posune datum o jeden den s přenosem den → měsíc → rok (po 2099 zpět
+  * na 2000). Volá se při přenosu z hodin o půlnoci.
+  */
+ void datum_dalsi_den(datum_t *d) {
+     if (d->den < datum_dni(d)) {
+         d->den = bcd_inc(d->den);
+         return;
+     }
+     d->den = 0x01;
+     if (d->mesic < 0x12) {
+         d->mesic = bcd_inc(d->mesic);
+         return;
+     }
+     d->mesic = 0x01;
+     d->rok = (d->rok == 0x99) ? 0x00 : bcd_inc(d->rok);
+ }
+ 
+ /*
+  * Funkce: datum_zadej_cislici
+  * ---------------------------
+  * Přímé zadání jedné číslice data na pozici 0–3 (zleva: desítky dne,
+  * jednotky dne, desítky měsíce, jednotky měsíce). Odmítne číslici, se
+  * kterou by den přesáhl 31 nebo měsíc 12; délku měsíce opraví až
+  * datum_oprav() po skončení zadávání.
+  * Návrat: 1 = číslice přijata, 0 = odmítnuta
+  */
+ uint8_t datum_zadej_cislici(datum_t *d, uint8_t pozice, uint8_t cislice) {
+     switch (pozice) {
+     case 0:
+         if (cislice > 3) {
+             return 0;
+         }
+         d->den = (cislice << 4) | (d->den & 0x0F);
+         if (d->den > 0x31) {
+             d->den = 0x31;
+         }
+         break;
+     case 1:
+         if ((d->den >> 4) == 3 && cislice > 1) {
+             return 0;
+         }
+         d->den = (d->den & 0xF0) | cislice;
+         break;
+     case 2:
+         if (cislice > 1) {
+             return 0;
+         }
+         d->mesic = (cislice << 4) | (d->mesic & 0x0F);
+         if (d->mesic > 0x12) {
+             d->mesic = 0x12;
+         }
+         break;
+     default:
+         if ((d->mesic >> 4) == 1 && cislice > 2) {
+             return 0;
+         }
+         d->mesic = (d->mesic & 0xF0) | cislice;
+         break;
+     }
+     return 1;
+ }
+ 
+ /*
+  * Funkce: datum_oprav
+  * -------------------
+  * Uvede ručně zadané datum do platného rozsahu: nulový den či měsíc
+  * na 1, den za koncem měsíce (např. 31.04.) na poslední den měsíce.
+  */
+ void datum_oprav(datum_t *d) {
+     if (d->mesic == 0) {
+         d->mesic = 0x01;
+     }
+     if (d->den == 0) {
+         d->den = 0x01;
+     }
+     if (d->den > datum_dni(d)) {
+         d->den = datum_dni(d);
+     }
+ }
+ 
+ /*
+  * Funkce: cas_hhmm
+  * ----------------
+  * Vrátí hodiny a minuty jako jedno 16bitové BCD číslo 0xHHMM,
+  * takže porovnání času budíku je jediné 16bitové porovnání.
+  */
+ static inline uint16_t cas_hhmm(const cas_t *c) {
+     return ((uint16_t)c->hodiny << 8) | c->minuty;
+ }
+ 
+ /*
+  * Funkce: minuta_dne
+  * ------------------
+  * Převede BCD hodiny a minuty na minutu dne 0–1439. Jen násobení
+  * (ATmega32A má hardwarovou násobičku), volá se pouze při úpravách.
+  */
+ static uint16_t minuta_dne(const cas_t *c) {
+     uint8_t h = (c->hodiny >> 4) * 10 + (c->hodiny & 0x0F);
+     uint8_t m = (c->minuty >> 4) * 10 + (c->minuty & 0x0F);
+     return h * 60u + m;
+ }
+ 
+ /*
+  * Funkce: synchronizuj_minutu_tydne
+  * ---------------------------------
+  * Znovu spočítá minuta_tydne z aktuálního času a dne – po ručním
+  * nastavení času. Při běhu se minuta_tydne jen inkrementuje.
+  */
+ void synchronizuj_minutu_tydne(void) {
+     minuta_tydne = den_tydne * (uint16_t)MINUT_DNE + minuta_dne(&cas);
+ }
+ 
+ /*
+  * Funkce: prepocitej_dalsi_budik
+  * ------------------------------
+  * Najde nejbližší výskyt aktivního budíku po aktuální minutě a uloží jeho
+  * minutu v týdnu do dalsi_budik. Prochází dny od dneška (nejvýše 8, aby se
+  * našel i budík dnes v již uplynulý čas za týden) a v nich budíky
+  * v pořadí budiky_poradi – první vyhovující je hledaný. Volá se jen po
+  * úpravě budíků nebo času a po zazvonění, nikoli každou sekundu.
+  */
+ void prepocitej_dalsi_budik(void) {
+     SIM_POCET(SIM_PREPOCET_BUDIKU);
+     uint8_t  den    = den_tydne;
+     uint16_t zaklad = minuta_tydne - minuta_dne(&cas);  // začátek dneška
+ 
+     for (uint8_t d = 0; d <= 7; d++) {
+         uint8_t maska = 1 << den;
+         for (uint8_t k = 0; k < BUDIKU; k++) {
+             const budik_t *b = &budiky[budiky_poradi[k]];
+             if (!(b->dny & BUDIK_AKTIVNI) || !(b->dny & maska)) {
+                 continue;
+             }
+             uint16_t mt = zaklad + minuta_dne(&b->cas);
+             if (d == 0 && mt <= minuta_tydne) {
+                 continue;  // dnes už proběhl
+             }
+             dalsi_budik = mt;
+             return;
+         }
+         if (++den == 7) {
+             den = 0;
+             zaklad = 0;
+         } else {
+             zaklad += MINUT_DNE;
+         }
+     }
+     dalsi_budik = BUDIK_ZADNY;
+ }
+ 
+ /*
+  * Funkce: budiky_zmeneny
+  * ----------------------
+  * Po úpravě budíků znovu seřadí budiky_poradi podle času (vkládání,
+  * 8 prvků) a přepočítá nejbližší budík.
+  */
+ void budiky_zmeneny(void) {
+     for (uint8_t k = 1; k < BUDIKU; k++) {
+         uint8_t idx = budiky_poradi[k];
+         uint16_t hhmm = cas_hhmm(&budiky[idx].cas);
+         uint8_t j = k;
+         while (j > 0 && cas_hhmm(&budiky[budiky_poradi[j - 1]].cas) > hhmm) {
+             budiky_poradi[j] = budiky_poradi[j - 1];
+             j--;
+         }
+         budiky_poradi[j] = idx;
+     }
+     prepocitej_dalsi_budik();
+ }
+ 
+ #ifdef PROFIL
+ /*
+  * ISR(PROF_SHODA_VECT)
+  * --------------------
+  * Shoda časovače bzučáku – rozšiřuje jeho TCNT na hodiny profilování.
+  */
+ ISR(PROF_SHODA_VECT) {
+     prof_preteceni++;
+ }
+ 
+ /*
+  * Funkce: prof_cas
+  * ----------------
+  * Hodiny profilování v tikách (PROF_CYKLU_TIK cyklů), přetékají modulo 2^32.
+  * Volá se z hlavní smyčky i z přerušení; shodu, jejíž přerušení ještě
+  * neproběhlo, započítá podle příznaku.
+  */
+ static uint32_t prof_cas(void) {
+     uint16_t t;
+     uint32_t p;
+     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+         t = PROF_TCNT;
+         p = prof_preteceni;
+         if (PROF_SHODA_CEKA && t < PROF_MODUL / 2) {
+             p++;
+         }
+     }
+     return p * PROF_MODUL + t;
+ }
+ 
+ /*
+  * Funkce: prof_rozdil / prof_zapis
+  * --------------------------------
+  * Délka přerušení od vzorku TCNT při vstupu (kratší než perioda časovače)
+  * a její započtení do statistiky; při zaplnění čítače se součet i počet
+  * vydělí dvěma, průměr se tím nezmění.
+  */
+ static inline uint16_t prof_rozdil(uint16_t zacatek) {
+     int16_t d = (int16_t)(PROF_TCNT - zacatek);
+     if (d < 0) {
+         d += PROF_MODUL;
+     }
+     return d;
+ }
+ 
+ static inline void prof_zapis(prof_t *s, uint16_t tiky) {
+     if (s->pocet == 0xFFFF) {
+         s->pocet >>= 1;
+         s->soucet >>= 1;
+     }
+     if (s->pocet == 0 || tiky < s->min) {
+         s->min = tiky;
+     }
+     if (tiky > s->max) {
+         s->max = tiky;
+     }
+     s->soucet += tiky;
+     s->pocet++;
+ }
+ 
+ #define PROF_ZACATEK()  uint16_t prof_t0 = PROF_TCNT
+ #define PROF_KONEC(i)   prof_zapis(&prof_isr[i], prof_rozdil(prof_t0))
+ 
+ /*
+  * Funkce: prof_kos
+  * ----------------
+  * Započte dobu 'tiky' do log2 histogramu (viz PROF_SMYCKA_BIT), koše se
+  * nasytí na 65535.
+  */
+ static void prof_kos(uint16_t *hist, uint32_t tiky, uint8_t bit) {
+     uint32_t c = (tiky * PROF_CYKLU_TIK) >> bit;
+     uint8_t k = 0;
+     while (c && k < PROF_KOSU - 1) {
+         c >>= 1;
+         k++;
+     }
+     if (hist[k] != 0xFFFF) {
+         hist[k]++;
+     }
+ }
+ 
+ /*
+  * Funkce: prof_prerusni
+  * ---------------------
+  * Atomicky přečte statistiku přerušení 'i' v cyklech CPU.
+  */
+ static void prof_prerusni(uint8_t i, uint16_t *min, uint16_t *max, uint16_t *prumer) {
+     prof_t s;
+     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+         s = prof_isr[i];
+     }
+     *min    = s.min * PROF_CYKLU_TIK;
+     *max    = s.max * PROF_CYKLU_TIK;
+     *prumer = s.pocet ? (uint16_t)(s.soucet / s.pocet) * PROF_CYKLU_TIK : 0;
+ }
+ 
+ /*
+  * Funkce: prof_nejvyssi_kos
+  * -------------------------
+  * Index nejvyššího neprázdného koše histogramu (0 i pro prázdný).
+  */
+ static uint8_t prof_nejvyssi_kos(const uint16_t *hist) {
+     uint8_t k = PROF_KOSU - 1;
+     while (k && hist[k] == 0) {
+         k--;
+     }
+     return k;
+ }
+ #else
+ #define PROF_ZACATEK()
+ #define PROF_KONEC(i)
+ #endif
+ 
+ /*
+  * Funkce: klav_vloz
+  * -----------------
+  * Vloží událost klávesnice do kruhové fronty (volá se z ISR).
+  * Při plné frontě se událost zahodí – hlavní smyčka ji nestihla vybrat.
+  */
+ static inline void klav_vloz(uint8_t udalost) {
+     uint8_t dalsi = (klav_zapis + 1) & (KLAV_FRONTA - 1);
+     if (dalsi != klav_cteni) {
+         klav_fronta[klav_zapis] = udalost;
+ #ifdef PROFIL
+         klav_cas[klav_zapis] = prof_cas();
+ #endif
+         klav_zapis = dalsi;
+     }
+ }
+
+ /*
+  * Funkce: klav_sloupce
+  * --------------------
+  * Přečte sloupce klávesnice (bit 0–3 = sloupec 1–4, 1 = stisknut).
+  * S RTC základnou jsou PC6/PC7 vývody krystalu, sloupce 3 a 4 jsou na PB4/PB5.
+  */
+ static inline uint8_t klav_sloupce(void) {
+ #ifdef ZAKLADNA_RTC
+     return (((uint8_t)~deska::klavesnice::pin() >> 4) & 0x03)
+          | (((uint8_t)~deska::klavesnice_rtc::pin() >> 2) & 0x0C);
+ #else
+     return (uint8_t)(~deska::klavesnice::pin()) >> 4;
+ #endif
+ }
+ 
+ /*
+  * Funkce: klav_radky / klav_radky_stav
+  * ------------------------------------
+  * Zápis a čtení úrovně řádků klávesnice ve tvaru PORTC (bit 0–3 = řádek
+  * 1–4, log.0 = aktivní, horní bity drží pull‑up sloupců). Se SYNC jsou
+  * PC0/PC1 vývody SCL/SDA sběrnice TWI (jejich pull‑up zůstává zapnutý),
+  * řádky 1 a 2 jsou na PB6/PB7. PORTB mimo přerušení zapisuje jen
+  * obsluz_led() v atomickém bloku.
+  */
+ static inline void klav_radky(uint8_t u) {
+ #ifdef SYNC
+     deska::klavesnice::port() = u | 0x03;
+     deska::klavesnice_sync::port() = (deska::klavesnice_sync::port() & 0x3F) | (uint8_t)(u << 6);
+ #else
+     deska::klavesnice::port() = u;
+ #endif
+ }
+
+ static inline uint8_t klav_radky_stav(void) {
+ #ifdef SYNC
+     return (deska::klavesnice::port() & 0xFC) | (deska::klavesnice_sync::port() >> 6);
+ #else
+     return deska::klavesnice::port();
+ #endif
+ }
+
+ /*
+  * Funkce: skenuj_klavesnici
+  * -------------------------
+  * Neblokující sken maticové klávesnice 4×4, volá se z ISR(TIMER0_COMP_vect)
+  * jednou za slot číslice. Přečte sloupce (PINC<4..7>) řádku aktivovaného
+  * v minulém slotu (má tak celý slot na ustálení) a aktivuje další řádek
+  * (PORTC<0..3>=0).
+  * Stav řádku se přijme až po KLAV_DEBOUNCE shodných čteních (odrušení zákmitů),
+  * každá změna se pak zapíše do fronty jako stisk (kód) nebo puštění
+  * (kód | KLAV_PUSTENI). Držené klávesy se vedou v masce všech 16 kláves
+  * (libovolný počet současně stisknutých), takže lze rozpoznat akord C+D
+  * (KLAV_AKORD_CD, puštění jeho kláves se už nehlásí); zaseknuté klávesy
+  * (klav_vadne) se do akordu nepočítají. Automatické opakování držené
+  * klávesy řídí hlavní smyčka časovačem (viz klav_opakovani).
+  * Práce jednoho volání je omezená bez ohledu na stav matice: jeden řádek,
+  * nejvýše 4 změny sloupců, a to jen jednou za KLAV_DEBOUNCE čtení řádku;
+  * plná fronta události zahazuje. Vadná matice tak nemůže prodloužit
+  * přerušení nad pevnou mez ani zahltit hlavní smyčku.
+  */
+ static inline void skenuj_klavesnici(void) {
+     static uint8_t radek = 0;
+     static uint8_t kandidat[4];  // poslední přečtený stav sloupců každého řádku
+     static uint8_t shoda[4];     // počet shodných čtení kandidáta
+     static uint8_t stabilni[4];  // odrušený stav sloupců každého řádku
+     static uint16_t drzene = 0;  // maska držených kláves (bit = kód klávesy)
+     static uint16_t potlac = 0;  // klávesy akordu, jejichž puštění se nehlásí
+
+     uint8_t sloupce = klav_sloupce();
+     if (sloupce != kandidat[radek]) {
+         kandidat[radek] = sloupce;
+         shoda[radek] = 1;
+     } else if (shoda[radek] < KLAV_DEBOUNCE && ++shoda[radek] == KLAV_DEBOUNCE) {
+         uint8_t zmena = sloupce ^ stabilni[radek];
+         stabilni[radek] = sloupce;
+         for (uint8_t s = 0; zmena; s++, zmena >>= 1, sloupce >>= 1) {
+             if (!(zmena & 1)) {
+                 continue;
+             }
+             uint8_t kod = pgm_read_byte(&mapa_klaves[radek][s]);
+             uint16_t bit = 1u << kod;
+             if (sloupce & 1) {  // stisk
+                 drzene |= bit;
+                 klav_vloz(kod);
+                 if ((drzene & ~klav_vadne) == KLAV_AKORD_MASKA) {
+                     klav_vloz(KLAV_AKORD_CD);
+                     potlac = KLAV_AKORD_MASKA;
+                 }
+             } else {            // puštění
+                 drzene &= ~bit;
+                 if (potlac & bit) {
+                     potlac &= ~bit;
+                 } else {
+                     klav_vloz(kod | KLAV_PUSTENI);
+                 }
+             }
+         }
+     }
+
+     radek = (radek + 1) & 3;
+     klav_radky(~pgm_read_byte(&poz[radek]));  // aktivuje další řádek, horní bity drží pull‑up sloupců
+ }
+
+ #ifdef ZAKLADNA_RTC
+ /*
+  * Funkce: klav_libovolna
+  * ----------------------
+  * Aktivuje všechny řádky najednou a zjistí, zda je stisknuta některá
+  * klávesa. Používá se po probuzení z SLEEP_MODE_PWR_SAVE, kdy Timer0
+  * (a tedy sken klávesnice) stojí.
+  */
+ static uint8_t klav_libovolna(void) {
+     uint8_t stisk;
+     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+         uint8_t puvodni = klav_radky_stav();
+         klav_radky(puvodni & 0xF0);   // všechny řádky v log.0
+         _delay_us(5);             // ustálení sloupců
+         stisk = klav_sloupce();
+         klav_radky(puvodni);
+     }
+     return stisk;
+ }
+ #endif
+ 
+ /*
+  * Funkce: klav_udalost
+  * --------------------
+  * Vybere jednu událost z fronty klávesnice, nikdy neblokuje.
+  *
+  * Návrat: kód klávesy 0–15 (stisk), kód | KLAV_PUSTENI (puštění),
+  *         KLAV_AKORD_CD (akord C+D), KLAV_ZADNA = fronta je prázdná
+  */
+ uint8_t klav_udalost(void) {
+     if (klav_cteni == klav_zapis) {
+         return KLAV_ZADNA;
+     }
+     uint8_t udalost = klav_fronta[klav_cteni];
+ #ifdef PROFIL
+     prof_klav_cas = klav_cas[klav_cteni];
+ #endif
+     klav_cteni = (klav_cteni + 1) & (KLAV_FRONTA - 1);
+     return udalost;
+ }
+ 
+ /*
+  * Funkce: odecti_rad
+  * ------------------
+  * Vrátí číslici řádu 'rad' z *v a odečte ji (opakovaným odčítáním,
+  * bez dělení). Volá se od nejvyššího řádu.
+  */
+ static uint8_t odecti_rad(uint16_t *v, uint16_t rad) {
+     uint8_t c = 0;
+     while (*v >= rad) {
+         *v -= rad;
+         c++;
+     }
+     return c;
+ }
+ 
+ /*
+  * Funkce: zverejni_snimek
+  * -----------------------
+  * Sestaví z obrazu snímek pro ISR: v aktuální fázi blikání (stav_led)
+  * zhasne pozice z obraz_blik a rozsvítí tečky z obraz_tecky, převede
+  * segmenty na úrovně portu podle polarity desky a všem pozicím nastaví
+  * svit podle jasu. Volá se po složení obrazu a jednou za sekundu, pokud
+  * obraz něco bliká. Zapisuje do volného bufferu a teprve hotový snímek
+  * zveřejní.
+  */
+ void zverejni_snimek(void) {
+     SIM_POCET(SIM_SNIMEK);
+     uint8_t zverejneny = displej_zverejneny;
+     uint8_t cteny      = displej_cteny;  // ISR může přejít jen na zverejneny
+     uint8_t volny;
+     if (zverejneny != cteny) {
+         volny = 3 - zverejneny - cteny;  // jediný zbývající z indexů 0, 1, 2
+     } else {
+         volny = zverejneny ? 0 : 1;
+     }
+ 
+     volatile snimek_t *b = &displej[volny];
+     uint8_t zhasnout = stav_led ? obraz_blik  : 0;
+     uint8_t tecky    = stav_led ? obraz_tecky : 0;
+     uint8_t svit = pgm_read_byte(&jas_svit[jas]);
+     for (uint8_t p = 0; p < 4; p++) {
+         uint8_t seg = (zhasnout & 1) ? 0 : obraz[p];
+         if (tecky & 1) {
+             seg |= SEG_DP;
+         }
+         zhasnout >>= 1;
+         tecky >>= 1;
+         b->segmenty[p] = deska::segmenty::uroven(seg);
+         b->svit[p] = svit;
+     }
+ 
+     displej_zverejneny = volny;  // atomický zápis bajtu – zveřejnění snímku
+ }
+ 
+ /*
+  * Funkce: aktualizuj_displej
+  * --------------------------
+  * Složí obraz podle aktuálního režimu (v režimu budíku čas vybraného
+  * budíku s tečkou vpravo, pokud je aktivní, jinak aktuální čas s dvojtečkou,
+  * která v normálním režimu bliká; v režimu hodin a data bliká číslice pod
+  * kurzorem) a v normálním režimu podle pohledu (čas, MM.SS, DD.MM., den
+  * v týdnu), případně zobrazí zprávu od okna zprava_posun, a zveřejní
+  * snímek. Volá se z hlavní smyčky jen při změně zobrazované hodnoty – po
+  * stisku klávesy, při posunu zprávy, při změně minuty (v pohledu MM.SS
+  * každou sekundu).
+  * Nibbly BCD jsou přímo indexy do znaky[], takže se nic nedělí.
+  */
+ void aktualizuj_displej(void) {
+     SIM_POCET(SIM_DISPLEJ);
+     obraz_blik  = 0;
+     obraz_tecky = 0;
+     if (displej_vypnut) {
+         memset(obraz, 0, sizeof(obraz));
+     } else if (zprava_sekund) {
+         for (uint8_t p = 0; p < 4; p++) {
+             obraz[p] = zprava[zprava_posun + 3 - p];
+         }
+     } else if (rezim_nastaveni == REZIM_KALIBRACE) {
+         uint8_t z[4];  // indexy znaků zleva doprava
+         uint16_t v;
+         if (mereni_stav == MERENI_START || mereni_stav == MERENI_BEZI) {
+             // „P nn“ – zbývající pulzy měření
+             z[0] = ZNAK_P;
+             z[1] = ZNAK_MEZERA;
+             v = MERENI_PULZU - (mereni_stav == MERENI_BEZI ? mereni_pulzy : 0);
+         } else {
+             // korekce se znaménkem, např. „- 12“ nebo „ 350“
+             z[0] = (korekce_ppm < 0) ? ZNAK_POMLCKA : ZNAK_MEZERA;
+             v = (korekce_ppm < 0) ? -korekce_ppm : korekce_ppm;
+             z[1] = odecti_rad(&v, 100);
+         }
+         z[2] = odecti_rad(&v, 10);
+         z[3] = v;
+         for (uint8_t p = 0; p < 4; p++) {
+             obraz[p] = znak(z[3 - p]);
+         }
+     } else if (rezim_nastaveni == REZIM_NAST_DAT
+                || (rezim_nastaveni == REZIM_NORMAL && pohled == POHLED_DATUM)) {
+         const datum_t *d = (rezim_nastaveni == REZIM_NAST_DAT) ? &uprava.datum : &datum;
+         obraz[0] = znak(d->mesic & 0x0F) | SEG_DP;
+         obraz[1] = znak(d->mesic >> 4);
+         obraz[2] = znak(d->den & 0x0F) | SEG_DP;
+         obraz[3] = znak(d->den >> 4);
+         if (rezim_nastaveni == REZIM_NAST_DAT) {
+             obraz_blik = 1 << (3 - kurzor);  // blikající kurzor
+         }
+     } else if (rezim_nastaveni == REZIM_NORMAL && pohled == POHLED_DEN) {
+         obraz[0] = znak(den_tydne + 1);
+         obraz[1] = znak(ZNAK_MEZERA);
+         obraz[2] = znak(pgm_read_byte(&den_zkratka[den_tydne][1]));
+         obraz[3] = znak(pgm_read_byte(&den_zkratka[den_tydne][0]));
+     } else if (rezim_nastaveni == REZIM_NORMAL && pohled == POHLED_SEKUNDY) {
+         obraz[0] = znak(cas.sekundy & 0x0F);
+         obraz[1] = znak(cas.sekundy >> 4);
+         obraz[2] = znak(cas.minuty & 0x0F) | SEG_DP;
+         obraz[3] = znak(cas.minuty >> 4);
+     } else {
+         const cas_t *c = (rezim_nastaveni == REZIM_NAST_BUD) ? &budiky[vybrany_budik].cas
+                        : (rezim_nastaveni == REZIM_NAST_HOD) ? &uprava.cas : &cas;
+         obraz[0] = znak(c->minuty & 0x0F);
+         obraz[1] = znak(c->minuty >> 4);
+         obraz[2] = znak(c->hodiny & 0x0F);
+         obraz[3] = znak(c->hodiny >> 4);
+         if (rezim_nastaveni == REZIM_NORMAL) {
+             obraz_tecky = 1 << POZICE_DVOJTECKA;      // dvojtečka bliká 1 Hz
+         } else {
+             obraz[POZICE_DVOJTECKA] |= SEG_DP;         // při nastavování svítí
+         }
+         if (rezim_nastaveni == REZIM_NAST_BUD && (budiky[vybrany_budik].dny & BUDIK_AKTIVNI)) {
+             obraz[0] |= SEG_DP;  // tečka = budík je aktivní
+         }
+         if (rezim_nastaveni == REZIM_NAST_HOD) {
+             obraz_blik = 1 << (3 - kurzor);  // blikající kurzor
+         }
+     }
+     zverejni_snimek();
+ }
+ 
+ /*
+  * ISR(TIMER0_COMP_vect)
+  * ---------------------
+  * Přerušení od Compare Match časovače0 v režimu CTC, dvakrát za slot číslice
+  * (MUX_HZ slotů za sekundu). Obsluhuje multiplexování 4 číslic na 7‑segmentu
+  * – pouze vypisuje předpočítané segmentové vzory z displej[], žádné dělení.
+  * Slot má dvě fáze, jejichž délku určuje OCR0 zapsaný v předchozí fázi:
+  *   - svit (svit[i] + 1 tiků, nejvýše MUX_SVIT) – číslice svítí,
+  *   - tma (zbytek slotu, nejméně MUX_ZATEMNENI tiků) – všechny pozice
+  *     vypnuté; zároveň brání tomu, aby se změna segmentů projevila
+  *     na předchozí číslici (ghosting).
+  * Poměr svitu a tmy řídí jas (PWM po číslicích), délka slotu se nemění.
+  * Hardwarový výstup OC0 nelze použít – PB3 je sekundová LED.
+  * Nový snímek převezme jen na začátku cyklu (i == 0), aby se nemíchaly
+  * dva snímky. V každém zatemnění navíc naskenuje jeden řádek klávesnice,
+  * případně spustí vyžádaný převod ADC (SVETLO), a na začátku každého
+  * slotu přičte jeho délku k systémovému tiku.
+  * Periodu určuje Timer0 v CTC hardwarově, ostatní přerušení (i konzole)
+  * jsou krátká a mohou začátek fáze zpozdit jen o několik µs.
+  */
+ ISR(TIMER0_COMP_vect) {
+     PROF_ZACATEK();
+     static uint8_t i = 0;
+     static uint16_t zlomek = 0;               // střádač zlomku tiku (cykly CPU)
+     static uint8_t svit = 0;                  // 1 = právě skončila fáze svitu
+     static uint8_t tma  = MUX_ZATEMNENI - 1;  // OCR0 následující fáze tmy
+ 
+     if (svit) {
+         deska::pozice::zapis_port(0);   // zatemnění – žádná pozice nevybrána
+         OCR0 = tma;
+         svit = 0;
+         skenuj_klavesnici();
+ #ifdef SVETLO
+         if (svetlo_vyzadan) {
+             svetlo_vyzadan = 0;
+             ADCSRA |= (1 << ADSC);
+         }
+ #endif
+     } else {
+         if (i == 0) {
+             displej_cteny = displej_zverejneny;
+         }
+         uint8_t t = TIK_ZA_SLOT;
+ #if TIK_ZBYTEK
+         zlomek += TIK_ZBYTEK;
+         if (zlomek >= MS_CYKLU) {
+             zlomek -= MS_CYKLU;
+             t++;
+         }
+ #endif
+         tiky_isr += t;
+         volatile snimek_t *b = &displej[displej_cteny];
+         uint8_t s = b->svit[i];
+         deska::segmenty::port::port() = b->segmenty[i];           // nastavení segmentů
+         deska::pozice::zapis_port(pgm_read_byte(&poz_displej[i])); // výběr pozice
+         i = (i + 1) & 3;                // cyklicky 0 → 1 → 2 → 3 → 0
+         OCR0 = s;
+         tma = (MUX_PERIODA - 2) - s;    // svit + tma = MUX_PERIODA tiků
+         svit = 1;
+     }
+     PROF_KONEC(PROF_MUX);
+ }
+ 
+ #ifdef SVETLO
+ /*
+  * ISR(ADC_vect)
+  * -------------
+  * Dokončený převod napětí fotorezistoru. Vzorek zapracuje do klouzavého
+  * průměru svetlo_ema; další převod proběhne až po vyžádání ze svetlo_krok(). Přerušení je neblokující
+  * (ISR_NOBLOCK) – multiplex displeje nikdy nečeká.
+  */
+ ISR(ADC_vect, ISR_NOBLOCK) {
+     svetlo_ema += ((int16_t)(ADC << 5) - (int16_t)svetlo_ema) >> SVETLO_EMA;
+ }
+ 
+ /*
+  * Funkce: svetlo_init
+  * -------------------
+  * Nastaví ADC: reference AVCC, kanál fotorezistoru desky, jednotlivé
+  * převody bez auto‑triggeru a předdělička 128 (125 kHz při 16 MHz).
+  * Převod spouští ISR(TIMER0_COMP_vect) až po zhasnutí pozic, takže vzorek
+  * (1,5 taktu ADC = 12 µs po startu) padne dovnitř zatemnění (nejméně
+  * ZATEMNENI_US), mimo rušení od přepínání multiplexu i mimo svit displeje.
+  * Compare Match jako spouštěč by převod začal přesně v okamžiku přepnutí.
+  */
+ void svetlo_init(void) {
+     ADMUX  = (1 << REFS0) | deska::svetlo_kanal;
+     ADCSRA = (1 << ADEN) | (1 << ADIE) | (1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0);
+ }
+ 
+ /*
+  * Funkce: svetlo_krok
+  * -------------------
+  * Obsluha časovače CAS_SVETLO (každých SVETLO_MS): z průměru okolního
+  * světla vybere úroveň jasu a vyžádá další převod. Úroveň se změní, až
+  * průměr přesáhne hranici současné úrovně o SVETLO_HYSTEREZE, takže jas
+  * na rozhraní dvou úrovní nekmitá. Automatický jas se do EEPROM neukládá.
+  */
+ void svetlo_krok(void) {
+     uint16_t e;
+     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+         e = svetlo_ema;
+     }
+     uint16_t dolni = (uint16_t)jas * SVETLO_KROK;
+     if ((e + SVETLO_HYSTEREZE < dolni) || (e >= dolni + SVETLO_KROK + SVETLO_HYSTEREZE)) {
+         jas = e / SVETLO_KROK;
+         zverejni_snimek();
+     }
+     svetlo_vyzadan = 1;       // další převod v nejbližším zatemnění
+ }
+ #endif
+ 
+ /*
+  * Funkce: casovace_init
+  * ---------------------
+  * Vyprázdní kolo časovačů.
+  */
+ void casovace_init(void) {
+     memset(casovace, 0, sizeof(casovace));
+     memset(kolo, CASOVAC_ZADNY, sizeof(kolo));
+     casovacu_bezi = 0;
+ }
+ 
+ /*
+  * Funkce: casovac_vloz
+  * --------------------
+  * Zařadí časovač 'id' na začátek seznamu slotu jeho vypršení.
+  */
+ static void casovac_vloz(uint8_t id, uint16_t vyprseni) {
+     casovac_t *c = &casovace[id];
+     uint8_t *slot = &kolo[(uint8_t)vyprseni & (KOLO_SLOTU - 1)];
+     c->vyprseni  = vyprseni;
+     c->predchozi = CASOVAC_ZADNY;
+     c->dalsi     = *slot;
+     if (*slot != CASOVAC_ZADNY) {
+         casovace[*slot].predchozi = id;
+     }
+     *slot = id;
+     c->bezi = 1;
+     casovacu_bezi++;
+ }
+ 
+ /*
+  * Funkce: casovac_vyjmi
+  * ---------------------
+  * Vyřadí běžící časovač 'id' ze seznamu jeho slotu.
+  */
+ static void casovac_vyjmi(uint8_t id) {
+     casovac_t *c = &casovace[id];
+     if (c->predchozi == CASOVAC_ZADNY) {
+         kolo[(uint8_t)c->vyprseni & (KOLO_SLOTU - 1)] = c->dalsi;
+     } else {
+         casovace[c->predchozi].dalsi = c->dalsi;
+     }
+     if (c->dalsi != CASOVAC_ZADNY) {
+         casovace[c->dalsi].predchozi = c->predchozi;
+     }
+     c->bezi = 0;
+     casovacu_bezi--;
+ }
+ 
+ /*
+  * Funkce: casovac_spust
+  * ---------------------
+  * (Znovu) spustí časovač 'id': vyprší za 'ms' tiků (nejméně 1), poté
+  * s nenulovou 'perioda' opakovaně každých 'perioda' tiků. Volá-li se
+  * z obsluhy časovače, počítá se od jeho vypršení, takže se čas neposouvá.
+  */
+ void casovac_spust(uint8_t id, uint16_t ms, uint16_t perioda) {
+     if (casovace[id].bezi) {
+         casovac_vyjmi(id);
+     }
+     casovace[id].perioda = perioda;
+     casovac_vloz(id, tik + (ms ? ms : 1));
+ }
+ 
+ void casovac_zastav(uint8_t id) {
+     if (casovace[id].bezi) {
+         casovac_vyjmi(id);
+     }
+ }
+ 
+ /*
+  * Funkce: casovace_cekaji
+  * -----------------------
+  * Dožene tiky, v jejichž slotu není žádný časovač (nemají co obsloužit).
+  * Volá se i se zakázanými přerušeními z cekej_na_udalost().
+  *
+  * Návrat: 1 = další nezpracovaný tik má ve slotu časovač, 0 = tiky dohnány
+  */
+ static uint8_t casovace_cekaji(void) {
+     while (tiky_zpracovane != tiky_isr) {
+         if (kolo[(uint8_t)(tik + 1) & (KOLO_SLOTU - 1)] != CASOVAC_ZADNY) {
+             return 1;
+         }
+         tiky_zpracovane++;
+         tik++;
+     }
+     return 0;
+ }
+ 
+ /*
+  * Funkce: zakladna_sekunda
+  * ------------------------
+  * Společná část ISR časové základny – toggluje stav_led a zvýší čítač
+  * sekundy_isr, který hlavní smyčka dohání (žádná sekunda se neztratí).
+  */
+ static inline void zakladna_sekunda(void) {
+     sekundy_isr++;             // signalizuj hlavní smyčce
+     stav_led         = !stav_led;
+ }
+ 
+ #ifdef ZAKLADNA_RTC
+ /*
+  * ISR(TIMER2_COMP_vect)
+  * ---------------------
+  * Přerušení od Compare Match časovače2 (asynchronně z 32,768 kHz) každou
+  * půlsekundu. Na hranici sekundy upraví délku následující půlsekundy
+  * podle korekce krystalu a zavolá zakladna_sekunda().
+  */
+ ISR(TIMER2_COMP_vect) {
+     PROF_ZACATEK();
+     static uint8_t pulka  = 0;  // 1 = skončila první půlsekunda
+     static int16_t strada = 0;  // Bresenhamův střádač korekce
+ 
+     pulka ^= 1;
+     if (pulka) {
+         OCR2 = RTC_PULPERIODA - 1;  // druhá půlsekunda má vždy jmenovitou délku
+     } else {
+         uint8_t perioda = RTC_PULPERIODA - 1;
+         strada += korekce_rtc;
+         if (strada >= RTC_TIK_PPM4) {
+             strada -= RTC_TIK_PPM4;
+             perioda++;
+         } else if (strada <= -RTC_TIK_PPM4) {
+             strada += RTC_TIK_PPM4;
+             perioda--;
+         }
+         OCR2 = perioda;
+ 
+         zakladna_sekunda();
+     }
+     PROF_KONEC(PROF_ZAKLADNA);
+ }
+ #else
+ /*
+  * ISR(TIMER1_COMPA_vect)
+  * ----------------------
+  * Přerušení od Compare Match A časovače1 – generuje přesnou 1 Hz.
+  * Délku každé sekundy upravuje podle korekce krystalu (se SYNC=SLAVE
+  * i o krok dorovnání fáze k masteru) a zavolá zakladna_sekunda().
+  */
+ ISR(TIMER1_COMPA_vect) {
+     PROF_ZACATEK();
+     static uint8_t strada = 0;  // Bresenhamův střádač zlomku korekce
+ 
+     // délka právě začaté sekundy (v CTC se OCR1A uplatní hned)
+     uint16_t perioda = T1_PERIODA - 1 + korekce_cele;
+     strada += korekce_zlomek;
+     if (strada >= 64) {
+         strada -= 64;
+         perioda++;
+     }
+ #ifdef SYNC_SLAVE
+     // plynulé dorovnání fáze k masteru, nejvýše SYNC_KROK tiků za sekundu
+     int16_t zbyva = sync_zbyva;
+     if (zbyva) {
+         int16_t krok = (zbyva > SYNC_KROK) ? SYNC_KROK : (zbyva < -SYNC_KROK) ? -SYNC_KROK : zbyva;
+         perioda   += krok;
+         sync_zbyva = zbyva - krok;
+     }
+ #endif
+     OCR1A = perioda;
+ 
+     zakladna_sekunda();
+     PROF_KONEC(PROF_ZAKLADNA);
+ }
+ 
+ /*
+  * ISR(TIMER1_CAPT_vect)
+  * ---------------------
+  * Záchyt hrany 1PPS na ICP1 při měření kmitočtu krystalu. Uloží čas
+  * prvního a MERENI_PULZU-tého pulzu (počet period Timer1 + ICR1).
+  * Pokud CTC proběhl těsně před záchytem a jeho ISR ještě neběželo
+  * (záchyt má vyšší prioritu), přičte chybějící periodu.
+  */
+ ISR(TIMER1_CAPT_vect) {
+     uint16_t zachyceno = ICR1;
+     uint8_t  periody   = sekundy_isr;
+     if ((TIFR & (1 << OCF1A)) && zachyceno < T1_PERIODA / 2) {
+         periody++;
+     }
+ 
+     if (mereni_stav == MERENI_START) {
+         mereni_zacatek         = zachyceno;
+         mereni_zacatek_periody = periody;
+         mereni_pulzy           = 0;
+         mereni_stav            = MERENI_BEZI;
+     } else if (mereni_stav == MERENI_BEZI && ++mereni_pulzy == MERENI_PULZU) {
+         mereni_konec         = zachyceno;
+         mereni_konec_periody = periody;
+         mereni_stav          = MERENI_HOTOVO;
+     }
+ }
+ 
+ #endif
+ 
+ /*
+  * Funkce: zakladna_init
+  * ---------------------
+  * Inicializace zvolené časové základny 1 Hz.
+  */
+ void zakladna_init(void) {
+ #ifdef ZAKLADNA_RTC
+     // postup podle datasheetu pro přepnutí Timer2 na asynchronní hodiny
+     TIMSK &= ~((1 << OCIE2) | (1 << TOIE2));
+     ASSR  |= (1 << AS2);
+     TCNT2  = 0;
+     OCR2   = RTC_PULPERIODA - 1;
+     TCCR2  = (1 << WGM21)               // CTC režim
+            | (1 << CS22) | (1 << CS20); // prescaler = 128
+     while (ASSR & ((1 << TCN2UB) | (1 << OCR2UB) | (1 << TCR2UB))) ;
+     TIFR   = (1 << OCF2) | (1 << TOV2);
+     TIMSK |= (1 << OCIE2);              // povolit Compare Match
+ #else
+     TCCR1B = (1 << WGM12)   // CTC režim
+            | (1 << CS12)    // prescaler = 1024
+            | (1 << CS10);
+     OCR1A = T1_PERIODA - 1; // 16 MHz/1024/15625 = 1 Hz
+     TIMSK |= (1 << OCIE1A); // povolit Compare Match A
+ #endif
+ }
+ 
+ /*
+  * Funkce: bzucak_init / bzucak_ton
+  * --------------------------------
+  * Tón bzučáku z časovače nevyužitého časovou základnou v režimu CTC
+  * s přepínáním výstupu OCxx při shodě – nepotřebuje žádné přerušení.
+  * Při vypnutí se výstup přepne na nulování při shodě a FOCxx ho ihned
+  * stáhne do log.0, takže bzučák nezůstane pod stejnosměrným napětím.
+  */
+ #ifdef ZAKLADNA_RTC
+ void bzucak_init(void) {
+     OCR1A  = BZUCAK_OCR;
+     TCCR1A = (1 << COM1A1) | (1 << FOC1A);  // OC1A = 0
+     TCCR1B = (1 << WGM12) | BZUCAK_KLID_CS; // CTC
+ #ifdef PROFIL
+     TIMSK |= (1 << OCIE1A);                 // čítač period pro hodiny profilování
+ #endif
+     DDRD  |= (1 << PD5);
+ }
+ 
+ void bzucak_ton(uint8_t zapnout) {
+     if (zapnout) {
+         TCCR1A = (1 << COM1A0);                  // přepínání OC1A
+         TCCR1B = (1 << WGM12) | BZUCAK_CS;       // start, prescaler = 8
+     } else {
+         TCCR1B = (1 << WGM12) | BZUCAK_KLID_CS;
+         TCCR1A = (1 << COM1A1) | (1 << FOC1A);  // OC1A = 0
+     }
+ }
+ #else
+ void bzucak_init(void) {
+     OCR2  = BZUCAK_OCR;
+     TCCR2 = (1 << WGM21) | (1 << COM21) | (1 << FOC2) | BZUCAK_KLID_CS;  // CTC, OC2 = 0
+ #ifdef PROFIL
+     TIMSK |= (1 << OCIE2);                  // čítač period pro hodiny profilování
+ #endif
+     DDRD |= (1 << PD7);
+ }
+ 
+ void bzucak_ton(uint8_t zapnout) {
+     if (zapnout) {
+         TCCR2 = (1 << WGM21) | (1 << COM20) | BZUCAK_CS;  // přepínání OC2, prescaler = 32
+     } else {
+         TCCR2 = (1 << WGM21) | (1 << COM21) | (1 << FOC2) | BZUCAK_KLID_CS;  // OC2 = 0
+     }
+ }
+ #endif
+ 
+ /*
+  * Funkce: nastav_korekci
+  * ----------------------
+  * Nastaví korekci krystalu v ppm a převede ji do tvaru pro ISR časové
+  * základny (Timer1: celé tiky a zlomek, RTC: čtvrtiny ppm). Vícebajtové
+  * hodnoty se mění v atomickém bloku (jen při úpravě, ne za běhu).
+  */
+ void nastav_korekci(int16_t ppm) {
+     korekce_ppm = ppm;
+     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+ #ifdef ZAKLADNA_RTC
+         korekce_rtc = ppm * 4;
+ #else
+         korekce_cele   = ppm >> 6;    // aritmetický posun = zaokrouhlení dolů
+         korekce_zlomek = ppm & 63;
+ #endif
+     }
+ }
+ 
+ /*
+  * Funkce: mereni_spust / mereni_zastav
+  * ------------------------------------
+  * Spuštění a ukončení měření kmitočtu proti 1PPS na ICP1. Během měření je
+  * korekce vypnutá, aby každá sekunda měla přesně T1_PERIODA tiků.
+  */
+ #ifndef ZAKLADNA_RTC
+ void mereni_spust(void) {
+     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+         korekce_cele   = 0;  // korekce_ppm zůstává pro případ přerušení měření
+         korekce_zlomek = 0;
+ #ifdef SYNC_SLAVE
+         sync_zbyva     = 0;  // ani dorovnání fáze k masteru
+ #endif
+     }
+     mereni_stav = MERENI_START;
+     TIFR   = (1 << ICF1);                  // zahodit starý záchyt
+     TCCR1B |= (1 << ICNC1) | (1 << ICES1); // potlačení šumu, náběžná hrana
+     TIMSK |= (1 << TICIE1);
+ }
+ 
+ #endif
+ 
+ void mereni_zastav(void) {
+     TIMSK &= ~(1 << TICIE1);
+     mereni_stav = MERENI_NECINNE;
+ }
+ 
+ /*
+  * Funkce: mereni_vysledek
+  * -----------------------
+  * Ze záchytů prvního a posledního pulzu spočítá chybu krystalu v ppm:
+  * tiky = periody × T1_PERIODA + konec − začátek, chyba = tiky − očekávané.
+  * Díky MERENI_PULZU = 64 je jeden tik přesně 1 ppm, takže se nedělí.
+  */
+ #ifndef ZAKLADNA_RTC
+ int16_t mereni_vysledek(void) {
+     uint8_t periody = mereni_konec_periody - mereni_zacatek_periody;
+     int32_t tiky = (int32_t)periody * T1_PERIODA
+                  + (int32_t)mereni_konec - (int32_t)mereni_zacatek;
+     int32_t ppm = tiky - (int32_t)MERENI_PULZU * T1_PERIODA;
+     if (ppm > KOREKCE_MAX) {
+         ppm = KOREKCE_MAX;
+     } else if (ppm < -KOREKCE_MAX) {
+         ppm = -KOREKCE_MAX;
+     }
+     return (int16_t)ppm;
+ }
+ #endif
+
+ #ifdef SYNC
+ /*
+  * Funkce: sync_init
+  * -----------------
+  * Zapnutí TWI se SCL 100 kHz; slave navíc odpovídá na obecné volání
+  * a každý přijatý bajt potvrzuje.
+  */
+ void sync_init(void) {
+     TWBR = SYNC_TWBR;
+     TWSR = 0;                    // předdělička 1
+ #ifdef SYNC_SLAVE
+     TWAR = (SYNC_ADRESA << 1) | (1 << TWGCE);
+     TWCR = (1 << TWEA) | (1 << TWEN) | (1 << TWIE);
+ #else
+     TWCR = (1 << TWEN);
+ #endif
+ }
+
+ static inline void sync_chyba(void) {
+     if (sync_chyby < 255) {
+         sync_chyby++;
+     }
+ }
+
+ #ifdef SYNC_MASTER
+ /*
+  * Funkce: sync_vysli
+  * ------------------
+  * Master: na začátku minuty sestaví rámec z běžícího času a odstartuje
+  * vysílání; adresu i bajty rámce posílá ISR(TWI_vect), nic se nečeká.
+  * Nedokončený minulý rámec (zaseknutá sběrnice) se zahodí a TWI se
+  * znovu zapne.
+  */
+ void sync_vysli(void) {
+     if (sync_stav != SYNC_VOLNO) {
+         TWCR = 0;
+         sync_chyba();
+     }
+     sync_ramec[0] = cas.sekundy;
+     sync_ramec[1] = cas.minuty;
+     sync_ramec[2] = cas.hodiny;
+     sync_ramec[3] = den_tydne;
+     sync_ramec[4] = datum.den;
+     sync_ramec[5] = datum.mesic;
+     sync_ramec[6] = datum.rok;
+     sync_index = 0;
+     sync_stav  = SYNC_VYSILA;
+     TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN) | (1 << TWIE);
+ }
+
+ /*
+  * ISR(TWI_vect)
+  * -------------
+  * Master: START, obecné volání pro zápis, bajty rámce a STOP. Bez odezvy
+  * (žádný slave), při chybě sběrnice nebo ztrátě arbitráže se rámec
+  * zahodí a sběrnice uvolní.
+  */
+ ISR(TWI_vect) {
+     switch (TW_STATUS) {
+     case TW_START:
+         TWDR = 0x00 | TW_WRITE;  // obecné volání
+         break;
+     case TW_MT_SLA_ACK:
+     case TW_MT_DATA_ACK:
+         if (sync_index < SYNC_RAMEC) {
+             TWDR = sync_ramec[sync_index++];
+             break;
+         }
+         TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN);  // rámec odeslán
+         sync_stav = SYNC_VOLNO;
+         return;
+     case TW_MT_ARB_LOST:
+         TWCR = (1 << TWINT) | (1 << TWEN);  // sběrnici má jiný master, bez STOP
+         sync_chyba();
+         sync_stav = SYNC_VOLNO;
+         return;
+     default:
+         TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN);
+         sync_chyba();
+         sync_stav = SYNC_VOLNO;
+         return;
+     }
+     TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
+ }
+ #else
+ #define SYNC_ZAHODIT 0xFF  // sync_index: rámec se nepřijímá (příliš dlouhý, minulý nezpracovaný)
+
+ /*
+  * ISR(TWI_vect)
+  * -------------
+  * Slave: při vlastní adrese nebo obecném volání si zapamatuje fázi Timer1
+  * a sekundy_isr (CTC, jehož ISR ještě neproběhlo, se přičte jako
+  * v ISR(TIMER1_CAPT_vect)), bajty ukládá do sync_ramec a po STOP předá
+  * rámec správné délky hlavní smyčce.
+  */
+ ISR(TWI_vect) {
+     switch (TW_STATUS) {
+     case TW_SR_SLA_ACK:
+     case TW_SR_GCALL_ACK: {
+         uint16_t faze    = TCNT1;
+         uint8_t  sekundy = sekundy_isr;
+         if ((TIFR & (1 << OCF1A)) && faze < T1_PERIODA / 2) {
+             sekundy++;
+         }
+         if (sync_stav == SYNC_VOLNO) {
+             sync_faze    = faze;
+             sync_sekundy = sekundy;
+             sync_index   = 0;
+         } else {
+             sync_index = SYNC_ZAHODIT;
+         }
+         break;
+     }
+     case TW_SR_DATA_ACK:
+     case TW_SR_GCALL_DATA_ACK:
+         if (sync_index < SYNC_RAMEC) {
+             sync_ramec[sync_index++] = TWDR;
+         } else {
+             sync_index = SYNC_ZAHODIT;
+         }
+         break;
+     case TW_SR_STOP:
+         if (sync_index == SYNC_RAMEC) {
+             sync_stav = SYNC_PRIJATO;
+         } else {
+             sync_chyba();
+         }
+         break;
+     case TW_BUS_ERROR:
+         TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEA) | (1 << TWEN) | (1 << TWIE);
+         sync_chyba();
+         return;
+     default:
+         break;
+     }
+     TWCR = (1 << TWINT) | (1 << TWEA) | (1 << TWEN) | (1 << TWIE);
+ }
+
+ /*
+  * Funkce: sync_platny / sync_sekunda_dne
+  * --------------------------------------
+  * Kontrola rozsahů BCD rámce a převod času na sekundu dne 0–86399.
+  */
+ static uint8_t sync_bcd(uint8_t v, uint8_t min, uint8_t max) {
+     return (v & 0x0F) <= 9 && v >= min && v <= max;
+ }
+
+ static uint8_t sync_platny(const cas_t *c, uint8_t den, const datum_t *d) {
+     return sync_bcd(c->sekundy, 0x00, 0x59) && sync_bcd(c->minuty, 0x00, 0x59)
+         && sync_bcd(c->hodiny, 0x00, 0x23) && den < 7
+         && sync_bcd(d->mesic, 0x01, 0x12) && sync_bcd(d->rok, 0x00, 0x99)
+         && sync_bcd(d->den, 0x01, datum_dni(d));
+ }
+
+ static int32_t sync_sekunda_dne(const cas_t *c) {
+     return minuta_dne(c) * 60L + (c->sekundy >> 4) * 10 + (c->sekundy & 0x0F);
+ }
+
+ /*
+  * Funkce: sync_obsluz
+  * -------------------
+  * Slave: zpracuje přijatý rámec, až hlavní smyčka dohnala všechny
+  * sekundy. Místní čas v okamžiku rámce (běžící čas bez sekund napočítaných
+  * od té doby, s fází Timer1) se porovná s časem mastera a odchylku
+  * v tikách rozloží ISR(TIMER1_COMPA_vect) do délky dalších sekund.
+  * Odchylka nad SYNC_SKOK_TIKU se srovná skokem – převezme se čas i datum
+  * (posunuté o sekundy napočítané od rámce, i přes půlnoc) a plynule se
+  * dorovná jen fáze začaté sekundy. Jiné datum při stejné
+  * hodině (mezi stranami není půlnoc) se převezme bez zásahu do času.
+  * Během měření krystalu se rámce nepoužijí.
+  *
+  * Návrat: 1 = rámec zpracován, 0 = žádný rámec
+  */
+ static uint8_t sync_obsluz(void) {
+     uint8_t  r[SYNC_RAMEC];
+     uint16_t faze;
+     uint8_t  pozdeji;
+     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+         if (sync_stav != SYNC_PRIJATO || sekundy_zpracovane != sekundy_isr) {
+             return 0;
+         }
+         for (uint8_t i = 0; i < SYNC_RAMEC; i++) {
+             r[i] = sync_ramec[i];
+         }
+         faze      = sync_faze;
+         pozdeji   = sekundy_isr - sync_sekundy;
+         sync_stav = SYNC_VOLNO;
+     }
+     cas_t   c = { r[0], r[1], r[2] };
+     datum_t d = { r[4], r[5], r[6] };
+     if (!sync_platny(&c, r[3], &d)) {
+         sync_chyba();
+         return 1;
+     }
+     if (mereni_stav != MERENI_NECINNE) {
+         return 1;
+     }
+
+     int32_t rozdil = sync_sekunda_dne(&cas) - pozdeji - sync_sekunda_dne(&c);
+     if (rozdil > MINUT_DNE * 30L) {
+         rozdil -= MINUT_DNE * 60L;
+     } else if (rozdil < -MINUT_DNE * 30L) {
+         rozdil += MINUT_DNE * 60L;
+     }
+     int32_t odchylka = rozdil * T1_PERIODA + faze;
+     uint8_t prevzit  = memcmp(&datum, &d, sizeof(d)) != 0 || den_tydne != r[3];
+     if (odchylka > SYNC_SKOK_TIKU || odchylka < -SYNC_SKOK_TIKU) {
+         uint8_t zmena = 0;
+         cas = c;
+         while (pozdeji--) {
+             zmena |= cas_tick(&cas);
+         }
+         if (zmena & CAS_DEN) {   // od rámce začal nový den
+             datum_dalsi_den(&d);
+             if (++r[3] == 7) {
+                 r[3] = 0;
+             }
+         }
+         odchylka = faze;   // začatá sekunda začala o fázi dřív než u mastera
+         prevzit  = 1;
+         if (sync_skoky < 255) {
+             sync_skoky++;
+         }
+     } else if (cas.hodiny != c.hodiny) {
+         prevzit = 0;       // rámec z druhé strany půlnoci, datum se srovná samo
+     }
+     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+         sync_zbyva = (int16_t)odchylka;
+     }
+     if (prevzit) {
+         datum     = d;
+         den_tydne = r[3];
+         synchronizuj_minutu_tydne();
+         prepocitej_dalsi_budik();
+         if (rezim_nastaveni != REZIM_NAST_HOD && rezim_nastaveni != REZIM_NAST_DAT) {
+             aktualizuj_displej();
+         }
+     }
+     return 1;
+ }
+ #endif
+ #endif
+ 
+ /*
+  * ISR(EE_RDY_vect)
+  * ----------------
+  * Přerušení „EEPROM připravena“ – zapíše další bajt slotu z ee_buffer.
+  * Zápis bajtu trvá ~8,5 ms, ale probíhá v hardwaru, takže hlavní smyčka
+  * ani multiplex na něj nikdy nečekají. Po posledním bajtu se přerušení vypne.
+  */
+ ISR(EE_RDY_vect) {
+     if (ee_zbyva == 0) {
+         EECR &= ~(1 << EERIE);
+         return;
+     }
+     EEAR = ee_adresa++;
+     EEDR = *ee_data++;
+     EECR |= (1 << EEMWE);  // EEWE musí následovat do 4 taktů
+     EECR |= (1 << EEWE);
+     ee_zbyva--;
+ }
+ 
+ #ifdef ZAZNAM
+ /*
+  * Funkce: zaznam_vloz
+  * -------------------
+  * Vloží záznam do kruhu v RAM. Je‑li kruh plný (EEPROM nestíhá nebo
+  * běží výpis), záznam se zahodí a započítá do zaz_ztraty.
+  */
+ static void zaznam_vloz(uint8_t typ, uint8_t data, uint16_t hodnota) {
+     if ((uint8_t)(zaz_ram.zapis - zaz_ram.ulozeno) == ZAZ_RAM) {
+         if (zaz_ztraty < 255) {
+             zaz_ztraty++;
+         }
+         return;
+     }
+     zaznam_t *z = &zaz_ram.zaznamy[zaz_ram.zapis & (ZAZ_RAM - 1)];
+     z->typ     = typ;
+     z->data    = data;
+     z->hodnota = hodnota;
+     SIM_ZAZNAM(z);
+     zaz_ram.zapis++;
+     zaz_ram.kontrola = zaz_ram.zapis ^ zaz_ram.ulozeno ^ ZAZ_KONTROLA;
+ }
+ 
+ /*
+  * Funkce: zaznam_pis
+  * ------------------
+  * Zaznamená událost (ZAZ_KLAVESA, ZAZ_REZIM, ZAZ_ZVONEK) s odstupem
+  * od předchozí; po přestávce delší než ZAZ_ZNACKA_SEK nejdřív značku
+  * ZAZ_CAS, od které se pak odstup počítá. Jen několik přiřazení.
+  */
+ void zaznam_pis(uint8_t typ, uint8_t data) {
+     uint16_t odstup = tik - zaz_tik;
+     if (zaz_sekund >= ZAZ_ZNACKA_SEK) {
+         zaznam_vloz(ZAZ_CAS, cas.sekundy, minuta_tydne);
+         odstup = 0;
+     }
+     zaznam_vloz(typ, data, odstup);
+     zaz_tik    = tik;
+     zaz_sekund = 0;
+ }
+ 
+ /*
+  * Funkce: zaznam_budik
+  * --------------------
+  * Zaznamená nastavení budíku 'k' (pro přehrání záznamu v simulaci).
+  */
+ static void zaznam_budik(uint8_t k) {
+     const budik_t *b = &budiky[k];
+     zaznam_vloz(ZAZ_BUDIK | (k << ZAZ_INDEX), b->dny, ((uint16_t)b->cas.hodiny << 8) | b->cas.minuty);
+ }
+ 
+ /*
+  * Funkce: zaznam_init
+  * -------------------
+  * Po zapnutí napájení nebo s neplatnými ukazateli vyprázdní kruh v RAM,
+  * jinak nezapsané záznamy z doby před resetem zůstanou. Pokračování
+  * kruhu v EEPROM najde podle fáze prvních záznamů dávek: zapisuje se
+  * do první dávky, jejíž fáze se liší od dávky 0. Volá se před
+  * teply_start(), dokud MCUCSR obsahuje příčinu resetu.
+  */
+ void zaznam_init(void) {
+     if ((MCUCSR & (1 << PORF))
+         || zaz_ram.kontrola != (zaz_ram.zapis ^ zaz_ram.ulozeno ^ ZAZ_KONTROLA)
+         || (uint8_t)(zaz_ram.zapis - zaz_ram.ulozeno) > ZAZ_RAM
+         || (zaz_ram.ulozeno & (ZAZ_DAVKA - 1))) {
+         zaz_ram.zapis    = 0;
+         zaz_ram.ulozeno  = 0;
+         zaz_ram.kontrola = ZAZ_KONTROLA;
+     }
+ 
+     uint8_t faze0 = eeprom_read_byte(&ee_zaznam[0].typ) & ZAZ_FAZE;
+     zaz_davka = 0;
+     for (uint8_t d = 1; d < ZAZ_DAVEK; d++) {
+         if ((eeprom_read_byte(&ee_zaznam[d * ZAZ_DAVKA].typ) & ZAZ_FAZE) != faze0) {
+             zaz_davka = d;
+             break;
+         }
+     }
+     zaz_faze     = zaz_davka ? faze0 : faze0 ^ ZAZ_FAZE;  // celý kruh stejný = nový oběh
+     zaz_zapisuje = 0;
+     zaz_vypis    = 0;
+     zaz_sekund   = ZAZ_ZNACKA_SEK;
+     zaz_rezim    = REZIM_NORMAL;
+ }
+ 
+ /*
+  * Funkce: zaznam_start
+  * --------------------
+  * Zaznamená reset s příčinou 'pricina' a nastavené budíky, které se liší
+  * od výchozích; značka času se vloží před první další událost.
+  */
+ static void zaznam_start(uint8_t pricina) {
+     zaznam_vloz(ZAZ_RESET, pricina, 0);
+     for (uint8_t k = 0; k < BUDIKU; k++) {
+         if (budiky[k].dny != BUDIK_VSECHNY_DNY || budiky[k].cas.hodiny || budiky[k].cas.minuty) {
+             zaznam_budik(k);
+         }
+     }
+     zaz_sekund = ZAZ_ZNACKA_SEK;
+ }
+ 
+ /*
+  * Funkce: zaznam_uloz
+  * -------------------
+  * Volá se při každém průchodu hlavní smyčkou: dokončí zápis předchozí
+  * dávky a je‑li v RAM celá dávka, zahájí její zápis do EEPROM na pozadí
+  * v ISR(EE_RDY_vect). Čeká jen, dokud běží jiný zápis nebo výpis LOG.
+  */
+ void zaznam_uloz(void) {
+     if (ee_zbyva) {
+         return;
+     }
+     if (zaz_zapisuje) {
+         zaz_zapisuje = 0;
+         zaz_ram.ulozeno += ZAZ_DAVKA;
+         zaz_ram.kontrola = zaz_ram.zapis ^ zaz_ram.ulozeno ^ ZAZ_KONTROLA;
+         if (++zaz_davka == ZAZ_DAVEK) {
+             zaz_davka = 0;
+             zaz_faze ^= ZAZ_FAZE;
+         }
+     }
+     if ((uint8_t)(zaz_ram.zapis - zaz_ram.ulozeno) < ZAZ_DAVKA || zaz_vypis) {
+         return;
+     }
+     zaznam_t *z = &zaz_ram.zaznamy[zaz_ram.ulozeno & (ZAZ_RAM - 1)];
+     for (uint8_t i = 0; i < ZAZ_DAVKA; i++) {
+         z[i].typ = (z[i].typ & ~ZAZ_FAZE) | zaz_faze;
+     }
+     ee_data      = (const uint8_t *)z;
+     ee_adresa    = (uint16_t)(uintptr_t)&ee_zaznam[zaz_davka * ZAZ_DAVKA];
+     ee_zbyva     = ZAZ_DAVKA * sizeof(zaznam_t);
+     zaz_zapisuje = 1;
+     EECR |= (1 << EERIE);
+ }
+ 
+ /*
+  * Funkce: zaznam_cti
+  * ------------------
+  * Přečte záznam na pozici 'i' od nejstaršího: nejdřív kruh v EEPROM,
+  * za ním nezapsané záznamy z RAM (pozic je ZAZ_EEPROM + jejich počet).
+  * Čte EEPROM přímo, volat jen když neběží zápis (ee_zbyva == 0, EEWE).
+  *
+  * Návrat: 1 = záznam v *z (bez fáze), 0 = prázdné místo nebo konec
+  */
+ static uint8_t zaznam_cti(uint8_t i, zaznam_t *z) {
+     if (i < ZAZ_EEPROM) {
+         uint8_t j = zaz_davka * ZAZ_DAVKA + i;
+         if (j >= ZAZ_EEPROM) {
+             j -= ZAZ_EEPROM;
+         }
+         eeprom_read_block(z, &ee_zaznam[j], sizeof(*z));
+     } else if ((uint8_t)(i - ZAZ_EEPROM) < (uint8_t)(zaz_ram.zapis - zaz_ram.ulozeno)) {
+         *z = zaz_ram.zaznamy[(zaz_ram.ulozeno + i - ZAZ_EEPROM) & (ZAZ_RAM - 1)];
+     } else {
+         return 0;
+     }
+     if (z->typ == ZAZ_PRAZDNY) {
+         return 0;
+     }
+     z->typ &= ~ZAZ_FAZE;
+     return 1;
+ }
+ #endif
+ 
+ /*
+  * Funkce: nast_crc
+  * ----------------
+  * CRC‑16 přes pořadové číslo a data slotu.
+  */
+ static uint16_t nast_crc(const nast_slot_t *slot) {
+     const uint8_t *p = (const uint8_t *)slot;
+     uint16_t crc = 0xFFFF;
+     for (uint8_t i = 0; i < offsetof(nast_slot_t, crc); i++) {
+         crc = _crc16_update(crc, p[i]);
+     }
+     return crc;
+ }
+ 
+ /*
+  * Funkce: nastaveni_sestav
+  * ------------------------
+  * Naplní strukturu nastavení aktuálními hodnotami.
+  */
+ static void nastaveni_sestav(nastaveni_t *n) {
+     memcpy(n->budiky, budiky, sizeof(budiky));
+     n->jas = jas;
+ #ifdef SVETLO
+     if (svetlo_auto) {
+         n->jas = JAS_AUTO;
+     }
+ #endif
+     n->korekce_ppm = korekce_ppm;
+ }
+ 
+ /*
+  * Funkce: nast_tepla_crc / nast_tepla_uloz
+  * ----------------------------------------
+  * CRC kopie nastavení pro teplý restart a její obnovení po každé změně
+  * nast_ulozene, nast_slot, nast_sekvence nebo nast_poskozeno.
+  */
+ static uint16_t nast_tepla_crc(void) {
+     const uint8_t *p = (const uint8_t *)&nast_tepla;
+     uint16_t crc = 0xFFFF;
+     for (uint8_t i = 0; i < offsetof(nast_tepla_t, crc); i++) {
+         crc = _crc16_update(crc, p[i]);
+     }
+     return crc;
+ }
+
+ static void nast_tepla_uloz(void) {
+     nast_tepla.data      = nast_ulozene;
+     nast_tepla.slot      = nast_slot;
+     nast_tepla.sekvence  = nast_sekvence;
+     nast_tepla.poskozeno = nast_poskozeno;
+     nast_tepla.crc       = nast_tepla_crc();
+ }
+
+ /*
+  * Funkce: nastaveni_pouzij
+  * ------------------------
+  * Převezme budíky, jas a korekci krystalu z nast_ulozene (hodnoty mimo
+  * rozsah ponechá výchozí).
+  */
+ static void nastaveni_pouzij(void) {
+     memcpy(budiky, nast_ulozene.budiky, sizeof(budiky));
+     if (nast_ulozene.jas < JAS_UROVNI) {
+         jas = nast_ulozene.jas;
+     }
+ #ifdef SVETLO
+     svetlo_auto = (nast_ulozene.jas == JAS_AUTO);
+ #endif
+     if (nast_ulozene.korekce_ppm >= -KOREKCE_MAX && nast_ulozene.korekce_ppm <= KOREKCE_MAX) {
+         nastav_korekci(nast_ulozene.korekce_ppm);
+     }
+ }
+
+ /*
+  * Funkce: nastaveni_nacti
+  * -----------------------
+  * Při startu projde všechny sloty EEPROM, vybere nejnovější platný
+  * (správné CRC, nejvyšší pořadové číslo) a použije jeho hodnoty.
+  * Pokud žádný platný slot není, ponechá výchozí hodnoty; je‑li EEPROM
+  * přesto popsaná (poškozené nastavení), nastaví nast_poskozeno.
+  */
+ void nastaveni_nacti(void) {
+     uint8_t nalezen = 0;
+     uint8_t zapsano = 0;
+     nast_slot_t slot;
+ 
+     for (uint8_t i = 0; i < NAST_SLOTU; i++) {
+         eeprom_read_block(&slot, &ee_nastaveni[i], sizeof(slot));
+         if (slot.crc != nast_crc(&slot)) {
+             // nedopsaný nebo poškozený slot; smazaná EEPROM má všude 0xFF
+             for (uint8_t j = 0; j < sizeof(slot); j++) {
+                 zapsano |= ((const uint8_t *)&slot)[j] != 0xFF;
+             }
+             continue;
+         }
+         if (!nalezen || (int8_t)(slot.sekvence - nast_sekvence) > 0) {
+             nalezen       = 1;
+             nast_slot     = i;
+             nast_sekvence = slot.sekvence;
+             nast_ulozene  = slot.data;
+         }
+     }
+ 
+     nast_poskozeno = zapsano && !nalezen;  // nastavení ztraceno – signalizuje LED PB3
+     if (nalezen) {
+         nastaveni_pouzij();
+     }
+     nastaveni_sestav(&nast_ulozene);  // výchozí stav se zbytečně neukládá
+     nast_tepla_uloz();
+ }
+
+ /*
+  * Funkce: nastaveni_obnov
+  * -----------------------
+  * Teplý restart: s platnou kopií nast_tepla převezme nastavení i stav
+  * kruhu slotů bez čtení EEPROM. Zápis přerušený resetem nevadí – další
+  * uložení jde do následujícího slotu s vyšším pořadovým číslem a
+  * nedopsaný slot zůstane neplatný.
+  *
+  * Návrat: 1 = nastavení obnoveno, 0 = kopie neplatná
+  */
+ static uint8_t nastaveni_obnov(void) {
+     if (nast_tepla.crc != nast_tepla_crc()) {
+         return 0;
+     }
+     nast_ulozene   = nast_tepla.data;
+     nast_slot      = nast_tepla.slot;
+     nast_sekvence  = nast_tepla.sekvence;
+     nast_poskozeno = nast_tepla.poskozeno;
+     nastaveni_pouzij();
+     return 1;
+ }
+ 
+ /*
+  * Funkce: nastaveni_uloz
+  * ----------------------
+  * Uloží nastavení do dalšího slotu, ale jen pokud se od posledního uložení
+  * změnilo. Zápis proběhne na pozadí v ISR(EE_RDY_vect); pokud ještě běží
+  * předchozí zápis, zopakuje se za NAST_ZNOVU_MS časovačem CAS_ULOZENI
+  * (ten slouží i odloženému uložení jasu).
+  */
+ void nastaveni_uloz(void) {
+     if (ee_zbyva) {
+         casovac_spust(CAS_ULOZENI, NAST_ZNOVU_MS, 0);
+         return;
+     }
+ 
+     nastaveni_t n;
+     nastaveni_sestav(&n);
+     if (memcmp(&n, &nast_ulozene, sizeof(n)) == 0) {
+         return;  // beze změny – EEPROM se nezapisuje
+     }
+ #ifdef ZAZNAM
+     for (uint8_t k = 0; k < BUDIKU; k++) {
+         if (memcmp(&n.budiky[k], &nast_ulozene.budiky[k], sizeof(budik_t)) != 0) {
+             zaznam_budik(k);  // přehrání záznamu potřebuje nastavení budíků
+         }
+     }
+ #endif
+     nast_ulozene = n;
+     SIM_POCET(SIM_ULOZENI);
+ 
+     if (++nast_slot == NAST_SLOTU) {
+         nast_slot = 0;
+     }
+     ee_buffer.sekvence = ++nast_sekvence;
+     ee_buffer.data     = n;
+     ee_buffer.crc      = nast_crc(&ee_buffer);
+     nast_tepla_uloz();
+ 
+     ee_data   = (const uint8_t *)&ee_buffer;
+     ee_adresa = (uint16_t)(uintptr_t)&ee_nastaveni[nast_slot];
+     ee_zbyva  = sizeof(ee_buffer);
+     EECR |= (1 << EERIE);  // přerušení se vyvolá hned, EEPROM je volná
+ }
+ 
+ /*
+  * Funkce: zobraz_zpravu
+  * ---------------------
+  * Začne zobrazovat prvních 'delka' znaků zprava[] (nejméně 4). Delší
+  * zprávu po ZPRAVA_PRODLEVA posouvá časovač CAS_ZPRAVA.
+  */
+ static void zobraz_zpravu(uint8_t delka) {
+     zprava_delka  = delka;
+     zprava_posun  = 0;
+     zprava_sekund = ZPRAVA_SEKUND;
+     if (delka > 4) {
+         casovac_spust(CAS_ZPRAVA, ZPRAVA_PRODLEVA, ZPRAVA_POSUN);
+     } else {
+         casovac_zastav(CAS_ZPRAVA);
+     }
+ }
+ 
+ /*
+  * Funkce: posun_zpravy
+  * --------------------
+  * Obsluha časovače CAS_ZPRAVA: posune zprávu o znak doleva. Na konci
+  * zprávy časovač zastaví a konec nechá stát ZPRAVA_SEKUND sekund.
+  */
+ static void posun_zpravy(void) {
+     if (++zprava_posun >= zprava_delka - 4) {
+         casovac_zastav(CAS_ZPRAVA);
+         zprava_sekund = ZPRAVA_SEKUND;
+     }
+     aktualizuj_displej();
+ }
+ 
+ /*
+  * Funkce: zrus_zpravu
+  * -------------------
+  * Ukončí zobrazovanou zprávu (i rozpracovaný posun).
+  */
+ static void zrus_zpravu(void) {
+     zprava_sekund = 0;
+     casovac_zastav(CAS_ZPRAVA);
+ }
+ 
+ /*
+  * Funkce: ukaz_zpravu
+  * -------------------
+  * Zobrazí na ZPRAVA_SEKUND sekund zprávu ze 4 znaků (indexy do znaky[],
+  * zleva doprava), pak se displej vrátí k času.
+  */
+ void ukaz_zpravu(uint8_t z3, uint8_t z2, uint8_t z1, uint8_t z0) {
+     zprava[0] = znak(z3);
+     zprava[1] = znak(z2);
+     zprava[2] = znak(z1);
+     zprava[3] = znak(z0);
+     zobraz_zpravu(4);
+ }
+ 
+ /*
+  * Funkce: ukaz_budik
+  * ------------------
+  * Posuvná zpráva „AL n HH.MM“ s číslem a časem vybraného budíku. Končí
+  * oknem HH.MM, takže plynule přejde v zobrazení budíku.
+  */
+ static void ukaz_budik(void) {
+     const cas_t *c = &budiky[vybrany_budik].cas;
+     zprava[0] = znak(10);
+     zprava[1] = znak(ZNAK_L);
+     zprava[2] = znak(ZNAK_MEZERA);
+     zprava[3] = znak(vybrany_budik + 1);
+     zprava[4] = znak(ZNAK_MEZERA);
+     zprava[5] = znak(c->hodiny >> 4);
+     zprava[6] = znak(c->hodiny & 0x0F) | SEG_DP;
+     zprava[7] = znak(c->minuty >> 4);
+     zprava[8] = znak(c->minuty & 0x0F);
+     zobraz_zpravu(9);
+ }
+ 
+ #ifdef PROFIL
+ /*
+  * Funkce: ukaz_prof
+  * -----------------
+  * Diagnostika profilování na displeji – každé volání ukáže další stránku
+  * jako krátkou zprávu „písmeno + 3 číslice“:
+  *   A/b – max./průměrná délka ISR multiplexu [µs]
+  *   C/d – max./průměrná délka ISR časové základny [µs]
+  *   E/F – nejvyšší neprázdný koš histogramu smyčky/zpoždění kláves
+  */
+ void ukaz_prof(void) {
+     uint16_t min, max, prumer;
+     uint16_t v;
+     if (prof_stranka < 4) {
+         prof_prerusni(prof_stranka >> 1, &min, &max, &prumer);
+         v = ((prof_stranka & 1) ? prumer : max) / (F_CPU / 1000000UL);
+     } else {
+         v = prof_nejvyssi_kos(prof_stranka == 4 ? prof_smycka : prof_klavesa);
+     }
+     if (v > 999) {
+         v = 999;
+     }
+     uint8_t s = odecti_rad(&v, 100);
+     uint8_t d = odecti_rad(&v, 10);
+     ukaz_zpravu(10 + prof_stranka, s, d, v);
+     if (++prof_stranka == 6) {
+         prof_stranka = 0;
+     }
+ }
+ #endif
+ 
+ /*
+  * Funkce: uloz_cas
+  * ----------------
+  * Převzetí ručně nastaveného času: vynulování sekund, přepočet minuty
+  * v týdnu a nejbližšího budíku.
+  */
+ void uloz_cas(void) {
+     cas.sekundy = 0;
+     synchronizuj_minutu_tydne();
+     prepocitej_dalsi_budik();
+     nastaveni_uloz();
+ }
+ 
+ /*
+  * Funkce: uprava_zacni / uprava_prevezmi
+  * --------------------------------------
+  * Začátek nastavování hodin: kopie běžícího času, data a dne v týdnu
+  * do uprava. Konec: opravené datum a upravený čas se převezmou jedním
+  * přiřazením v hlavní smyčce (žádné přerušení s časem nepracuje), takže
+  * chod hodin během úprav nic nepřepíše; pak jako uloz_cas().
+  */
+ static void uprava_zacni(void) {
+     uprava.cas       = cas;
+     uprava.datum     = datum;
+     uprava.den_tydne = den_tydne;
+ }
+ 
+ static void uprava_prevezmi(void) {
+     datum_oprav(&uprava.datum);
+     cas       = uprava.cas;
+     datum     = uprava.datum;
+     den_tydne = uprava.den_tydne;
+     uloz_cas();
+ }
+ 
+ /*
+  * Funkce: zvonek_udalost
+  * ----------------------
+  * Jediný vstup stavového automatu budíku. Nový stav určí tabulka
+  * zvonek_prechody[], při vstupu do stavu se provede jeho akce (spuštění
+  * zvonění, naplánování odložení, zrušení). Událost, která stav nemění,
+  * nemá žádný účinek (kromě UD_BUDIK, který zvonění spustí znovu).
+  */
+ void zvonek_udalost(uint8_t udalost) {
+     uint8_t novy = pgm_read_byte(&zvonek_prechody[zvonek_stav][udalost]);
+     if (novy == zvonek_stav && udalost != UD_BUDIK) {
+         return;
+     }
+     ZAZ_UDALOST(ZAZ_ZVONEK, (udalost << 4) | novy);
+     zvonek_stav = novy;
+     budik_signal = (novy == ZVONEK_ZVONI);
+     budik_odlozen = BUDIK_ZADNY;
+ 
+     switch (novy) {
+     case ZVONEK_ZVONI:
+         zvoneni_sekund = 0;
+         zvoneni_minut = 0;
+         rytmus_krok = 0;  // rytmus začíná od prvního kroku
+         rytmus_vzor = 0;
+         displej_vypnut = 0;
+         break;
+     case ZVONEK_ODLOZENO:
+         budik_odlozen = minuta_tydne + ODLOZENI_MINUT;
+         if (budik_odlozen >= MINUT_TYDNE) {
+             budik_odlozen -= MINUT_TYDNE;
+         }
+         ukaz_zpravu(ZNAK_O, 13, ZNAK_MEZERA, ODLOZENI_MINUT);  // „od 5“
+         break;
+     default:
+         if (udalost == UD_VYPNI) {
+             ukaz_zpravu(ZNAK_MEZERA, ZNAK_O, 15, 15);  // „ oFF“
+         }
+         break;
+     }
+     aktualizuj_displej();
+ }
+ 
+ /*
+  * Funkce: obsluz_klavesu
+  * ----------------------
+  * Obsluha jedné události klávesnice z fronty: během zvonění jen odložení
+  * (libovolná klávesa) nebo vypnutí (#) budíku, jinak přepínání režimů (C, D), inkrementace hodin/minut (A, B) nebo jejich
+  * přímé zadání číslicemi 0–9 od pozice kurzoru, jas (*, #),
+  * v režimu hodin den v týdnu (#), v režimu budíku výběr budíku (#),
+  * jeho zapnutí/vypnutí (*) a dny v týdnu (1 = pondělí … 7 = neděle).
+  * Z režimu hodin vede * do kalibrace krystalu: A/B ±1 ppm, 0 nulování,
+  * # měření proti 1PPS, C uložení; D přepíná mezi zadáním času a data
+  * (číslice DDMM, A další rok). V normálním režimu A přepíná pohledy.
+  * C a D působí až při puštění, aby je šlo použít v akordu C+D (odložení
+  * zvonícího budíku, zrušení odloženého); opakování A/B se zpracuje jako stisk.
+  */
+ void obsluz_klavesu(uint8_t klavesa) {
+     SIM_POCET(SIM_KLAVESA);
+     if (klavesa & KLAV_PUSTENI) {
+         klavesa &= ~KLAV_PUSTENI;
+         if (klavesa != 12 && klavesa != 13) {
+             return;  // puštění ostatních kláves nemá žádnou akci
+         }
+     } else if (klavesa == 12 || klavesa == 13) {
+         return;      // C a D se vyhodnotí při puštění
+     }
+     uint8_t opakovani = klavesa & KLAV_OPAKOVANI;
+     klavesa &= ~KLAV_OPAKOVANI;
+     if (nast_poskozeno) {
+         nast_poskozeno = 0;  // libovolná klávesa potvrdí ztrátu nastavení
+         nast_tepla_uloz();
+     }
+     if (displej_vypnut) {
+         // první klávesa jen zapne displej
+         displej_vypnut = 0;
+         aktualizuj_displej();
+         return;
+     }
+     if (klavesa == KLAV_AKORD_CD) {
+         zvonek_udalost(zvonek_stav == ZVONEK_ODLOZENO ? UD_VYPNI : UD_ODLOZ);
+         return;
+     }
+     if (zvonek_stav == ZVONEK_ZVONI) {
+         // během zvonění klávesy jen ovládají budík
+         zvonek_udalost(klavesa == 15 ? UD_VYPNI : UD_ODLOZ);
+         return;
+     }
+ 
+     // Přepnutí/režim nastavení hodin (klávesa C = 12)
+     if (klavesa == 12) {
+         if (rezim_nastaveni == REZIM_NORMAL) {
+             rezim_nastaveni = REZIM_NAST_HOD;
+             kurzor = 0;
+             uprava_zacni();
+         } else if (rezim_nastaveni == REZIM_NAST_HOD || rezim_nastaveni == REZIM_NAST_DAT) {
+             // převzetí hodin a data, návrat do normálu, vynulování sekund
+             rezim_nastaveni = REZIM_NORMAL;
+             uprava_prevezmi();
+         } else if (rezim_nastaveni == REZIM_KALIBRACE) {
+             // uložení korekce, návrat do normálu
+             rezim_nastaveni = REZIM_NORMAL;
+             if (mereni_stav != MERENI_NECINNE) {
+                 mereni_zastav();
+                 nastav_korekci(korekce_ppm);  // nedokončené měření – původní korekce
+             }
+             nastaveni_uloz();
+         }
+     }
+ 
+     // Přepnutí/režim nastavení budíku (klávesa D = 13)
+     if (klavesa == 13) {
+         if (rezim_nastaveni == REZIM_NORMAL) {
+             rezim_nastaveni = REZIM_NAST_BUD;
+             budik_upraven = 0;
+             ukaz_budik();  // „AL n HH.MM“
+         } else if (rezim_nastaveni == REZIM_NAST_BUD) {
+             // uložení budíku, aktivace upraveného budíku
+             rezim_nastaveni = REZIM_NORMAL;
+             zrus_zpravu();
+             if (budik_upraven) {
+                 budiky[vybrany_budik].dny |= BUDIK_AKTIVNI;
+             }
+             budiky_zmeneny();
+             nastaveni_uloz();
+         } else if (rezim_nastaveni == REZIM_NAST_HOD) {
+             rezim_nastaveni = REZIM_NAST_DAT;   // z hodin k zadání data
+             kurzor = 0;
+         } else if (rezim_nastaveni == REZIM_NAST_DAT) {
+             rezim_nastaveni = REZIM_NAST_HOD;   // zpět k hodinám
+             datum_oprav(&uprava.datum);
+             kurzor = 0;
+         }
+     }
+ 
+     if (rezim_nastaveni == REZIM_NORMAL) {
+         // Další pohled (A = 10), opakování držené klávesy se nepřepíná
+         if (klavesa == 10 && !opakovani) {
+             if (++pohled == POHLEDU) {
+                 pohled = POHLED_CAS;
+             }
+         }
+ #ifdef SVETLO
+         // Automatický jas (B = 11) zapnout/vypnout, ruční změna ho vypne
+         if (klavesa == 11 && !opakovani) {
+             svetlo_auto ^= 1;
+             if (svetlo_auto) {
+                 ukaz_zpravu(10, ZNAK_U, ZNAK_T, ZNAK_O);    // „AUto“
+             } else {
+                 ukaz_zpravu(10, ZNAK_O, 15, 15);            // „AoFF“
+             }
+             casovac_spust(CAS_ULOZENI, NAST_ODKLAD_MS, 0);
+         }
+         if (klavesa == 14 || klavesa == 15) {
+             svetlo_auto = 0;
+         }
+ #endif
+         // Změna jasu displeje (* = 14 tmavší, # = 15 světlejší)
+         if (klavesa == 14) {
+             if (jas > 0) {
+                 jas--;
+                 casovac_spust(CAS_ULOZENI, NAST_ODKLAD_MS, 0);
+             } else {
+                 displej_vypnut = 1;  // pod nejnižším jasem se displej vypne
+             }
+         }
+         if (klavesa == 15 && jas < JAS_UROVNI - 1) {
+             jas++;
+             casovac_spust(CAS_ULOZENI, NAST_ODKLAD_MS, 0);
+         }
+ #ifdef PROFIL
+         if (klavesa == 0) {         // 0 – další diagnostická stránka
+             ukaz_prof();
+         }
+ #endif
+     } else if (rezim_nastaveni == REZIM_NAST_HOD) {
+         if (klavesa == 10) {        // A – hodiny
+             cas_pricti_hodinu(&uprava.cas);
+         }
+         if (klavesa == 11) {        // B – minuty
+             cas_pricti_minutu(&uprava.cas);
+         }
+         if (klavesa <= 9 && cas_zadej_cislici(&uprava.cas, kurzor, klavesa)) {
+             kurzor = (kurzor + 1) & 3;  // 0–9 – číslice na pozici kurzoru
+         }
+         if (klavesa == 15) {        // # – další den v týdnu
+             if (++uprava.den_tydne == 7) {
+                 uprava.den_tydne = 0;
+             }
+             ukaz_zpravu(13, ZNAK_MEZERA, ZNAK_MEZERA, uprava.den_tydne + 1);  // „d  n“
+         }
+         if (klavesa == 14) {        // * – převzetí času a přechod do kalibrace
+             rezim_nastaveni = REZIM_KALIBRACE;
+             uprava_prevezmi();
+         }
+     } else if (rezim_nastaveni == REZIM_NAST_DAT) {
+         if (klavesa <= 9 && datum_zadej_cislici(&uprava.datum, kurzor, klavesa)) {
+             kurzor = (kurzor + 1) & 3;  // 0–9 – číslice na pozici kurzoru
+         }
+         if (klavesa == 10) {        // A – další rok (zobrazí „20rr“)
+             uint8_t *rok = &uprava.datum.rok;
+             *rok = (*rok == 0x99) ? 0x00 : bcd_inc(*rok);
+             ukaz_zpravu(2, 0, *rok >> 4, *rok & 0x0F);
+         }
+     } else if (rezim_nastaveni == REZIM_KALIBRACE) {
+         if (mereni_stav == MERENI_NECINNE) {
+             if (klavesa == 10 && korekce_ppm < KOREKCE_MAX) {   // A – +1 ppm
+                 nastav_korekci(korekce_ppm + 1);
+             }
+             if (klavesa == 11 && korekce_ppm > -KOREKCE_MAX) {  // B – −1 ppm
+                 nastav_korekci(korekce_ppm - 1);
+             }
+             if (klavesa == 0) {                                 // 0 – bez korekce
+                 nastav_korekci(0);
+             }
+ #ifndef ZAKLADNA_RTC
+             if (klavesa == 15) {                                // # – měření proti 1PPS
+                 mereni_spust();
+             }
+ #endif
+         } else if (klavesa == 15) {                             // # – přerušení měření
+             mereni_zastav();
+             nastav_korekci(korekce_ppm);
+         }
+     } else {
+         budik_t *b = &budiky[vybrany_budik];
+         if (klavesa == 10) {        // A – hodiny budíku
+             cas_pricti_hodinu(&b->cas);
+             budik_upraven = 1;
+         }
+         if (klavesa == 11) {        // B – minuty budíku
+             cas_pricti_minutu(&b->cas);
+             budik_upraven = 1;
+         }
+         if (klavesa == 15) {        // # – výběr dalšího budíku
+             vybrany_budik = (vybrany_budik + 1) & (BUDIKU - 1);
+             budik_upraven = 0;
+             ukaz_budik();  // „AL n HH.MM“
+         }
+         if (klavesa == 14) {        // * – zapnutí/vypnutí budíku
+             b->dny ^= BUDIK_AKTIVNI;
+             budik_upraven = 0;
+             if (b->dny & BUDIK_AKTIVNI) {
+                 ukaz_zpravu(vybrany_budik + 1, ZNAK_MEZERA, ZNAK_O, ZNAK_N);  // „n on“
+             } else {
+                 ukaz_zpravu(vybrany_budik + 1, ZNAK_O, 15, 15);               // „noFF“
+             }
+         }
+         if (klavesa >= 1 && klavesa <= 7) {  // 1–7 – přepnutí dne v týdnu
+             b->dny ^= 1 << (klavesa - 1);
+             ukaz_zpravu(13, klavesa, ZNAK_O, (b->dny & (1 << (klavesa - 1))) ? ZNAK_N : 15);  // „dnon“/„dnoF“
+         }
+     }
+     aktualizuj_displej();
+ }
+ 
+ #ifdef KONZOLE
+ /*
+  * Funkce: konz_init
+  * -----------------
+  * Inicializace USART pro konzoli: KONZOLE_BAUD, 8N1, přerušení od příjmu.
+  */
+ void konz_init(void) {
+     UBRRH = KONZ_UBRR >> 8;
+     UBRRL = KONZ_UBRR & 0xFF;
+     UCSRA = (1 << U2X);
+     UCSRC = (1 << URSEL) | (1 << UCSZ1) | (1 << UCSZ0);  // 8 bitů, bez parity, 1 stop bit
+     UCSRB = (1 << RXCIE) | (1 << RXEN) | (1 << TXEN);
+ }
+ 
+ /*
+  * ISR(USART_RXC_vect)
+  * -------------------
+  * Příjem znaku do konz_rx[]. CR i LF ukončí řádek (prázdné řádky se
+  * zahodí), hotový řádek zvýší konz_radky. Při plném bufferu se znak
+  * zahodí; konec řádku pak přepíše jeho poslední znak značkou
+  * KONZ_PRETEKL, aby se zkrácený řádek odmítl a buffer se nezasekl.
+  */
+ ISR(USART_RXC_vect) {
+     static uint8_t prazdny = 1;  // 1 = z aktuálního řádku není v bufferu nic
+     uint8_t c = UDR;
+     uint8_t zapis = konz_rx_zapis;
+ 
+     if (c == '\r' || c == '\n') {
+         if (prazdny) {
+             return;
+         }
+         c = KONZ_KONEC;
+     }
+     uint8_t dalsi = (zapis + 1) & (KONZ_RX - 1);
+     if (dalsi == konz_rx_cteni) {
+         konz_rx_ztraty++;
+         if (c == KONZ_KONEC) {
+             konz_rx[(zapis - 1) & (KONZ_RX - 1)] = KONZ_PRETEKL;
+             prazdny = 1;
+             konz_radky++;
+         }
+         return;
+     }
+     konz_rx[zapis] = c;
+     konz_rx_zapis = dalsi;
+     prazdny = (c == KONZ_KONEC);
+     if (prazdny) {
+         konz_radky++;
+     }
+ }
+ 
+ /*
+  * ISR(USART_UDRE_vect)
+  * --------------------
+  * Odeslání dalšího znaku z konz_tx[]; po vyprázdnění bufferu se
+  * přerušení vypne (zapne ho znovu konz_pis).
+  */
+ ISR(USART_UDRE_vect) {
+     uint8_t cteni = konz_tx_cteni;
+     if (cteni == konz_tx_zapis) {
+         UCSRB &= ~(1 << UDRIE);
+         return;
+     }
+     UDR = konz_tx[cteni];
+     konz_tx_cteni = (cteni + 1) & (KONZ_TX - 1);
+ }
+ 
+ /*
+  * Funkce: konz_pis / konz_text / konz_bcd / konz_hex / konz_cislo(_zn)
+  * ------------------------------------------------------------------
+  * Neblokující výstup do konz_tx[]; při plném bufferu se znak zahodí
+  * (konz_tx_ztraty). Text je ve flash, čísla se převádějí bez dělení.
+  */
+ void konz_pis(uint8_t c) {
+     uint8_t dalsi = (konz_tx_zapis + 1) & (KONZ_TX - 1);
+     if (dalsi == konz_tx_cteni) {
+         if (konz_tx_ztraty < 255) {
+             konz_tx_ztraty++;
+         }
+         return;
+     }
+     konz_tx[konz_tx_zapis] = c;
+     konz_tx_zapis = dalsi;
+     UCSRB |= (1 << UDRIE);  // ISR nuluje UDRIE jen při prázdném bufferu
+ }
+ 
+ void konz_text(const char *p) {
+     uint8_t c;
+     while ((c = pgm_read_byte(p++)) != 0) {
+         konz_pis(c);
+     }
+ }
+ 
+ void konz_bcd(uint8_t b) {
+     konz_pis('0' + (b >> 4));
+     konz_pis('0' + (b & 0x0F));
+ }
+ 
+ void konz_hex(uint8_t b) {
+     uint8_t h = b >> 4;
+     uint8_t l = b & 0x0F;
+     konz_pis(h < 10 ? '0' + h : 'A' - 10 + h);
+     konz_pis(l < 10 ? '0' + l : 'A' - 10 + l);
+ }
+ 
+ const uint16_t konz_rady[5] PROGMEM = { 10000, 1000, 100, 10, 1 };
+ 
+ void konz_cislo(uint16_t v) {
+     uint8_t tisk = 0;  // nenulový = už se tiskne (bez úvodních nul)
+     for (uint8_t k = 0; k < 5; k++) {
+         uint8_t c = odecti_rad(&v, pgm_read_word(&konz_rady[k]));
+         tisk |= c | (k == 4);
+         if (tisk) {
+             konz_pis('0' + c);
+         }
+     }
+ }
+ 
+ void konz_cislo_zn(int16_t n) {
+     if (n < 0) {
+         konz_pis('-');
+         n = -n;  // korekce je v rozsahu ±KOREKCE_MAX
+     }
+     konz_cislo(n);
+ }
+ 
+ /*
+  * Funkce: konz_znak / konz_dalsi / konz_konec / konz_mezery
+  * ---------------------------------------------------------
+  * Čtení řádku přímo v konz_rx[] od pozice konz_i (bez kopírování).
+  */
+ static inline uint8_t konz_znak(void) {
+     return konz_rx[konz_i];
+ }
+ 
+ static inline void konz_dalsi(void) {
+     konz_i = (konz_i + 1) & (KONZ_RX - 1);
+ }
  
- // Příznaky a stavové proměnné
- volatile uint8_t sekunda_uplynula = 0;  // příznak uplynutí jedné sekundy
- volatile uint8_t stav_led        = 0;   // toggle bit pro blikání 1 Hz
+ static uint8_t konz_konec(void) {
+     uint8_t c = konz_znak();
+     return c == KONZ_KONEC || c == KONZ_PRETEKL;
+ }
  
- uint8_t rezim_nastaveni = REZIM_NORMAL; // aktuální režim (normál/hodiny/budík)
- uint8_t z_klavesa;                      // kód poslední stisknuté klávesy
+ static void konz_mezery(void) {
+     while (konz_znak() == ' ') {
+         konz_dalsi();
+     }
+ }
  
- // Proměnné pro aktuální čas
- uint16_t hodiny  = 0;   // 0–23
- uint16_t minuty  = 0;   // 0–59
- uint16_t sekundy = 0;   // 0–59
+ /*
+  * Funkce: konz_slovo
+  * ------------------
+  * Porovná slovo na pozici parseru s klíčovým slovem ve flash (bez ohledu
+  * na velikost písmen); při shodě za ním následuje mezera nebo konec řádku.
+  * Návrat: 1 = shoda (parser se posune za slovo), 0 = jiné slovo
+  */
+ static uint8_t konz_slovo(const char *slovo) {
+     uint8_t i = konz_i;
+     uint8_t c;
+     while ((c = pgm_read_byte(slovo++)) != 0) {
+         if ((konz_rx[i] & ~0x20) != c) {
+             return 0;
+         }
+         i = (i + 1) & (KONZ_RX - 1);
+     }
+     c = konz_rx[i];
+     if (c != ' ' && c != KONZ_KONEC && c != KONZ_PRETEKL) {
+         return 0;
+     }
+     konz_i = i;
+     return 1;
+ }
  
- // Proměnné pro čas budíku
- uint16_t budik_hodiny = 0;  // 0–23
- uint16_t budik_minuty = 0;  // 0–59
- uint8_t  budik_aktivni = 0; // 0 = neaktivní, 1 = aktivní
- uint8_t  budik_signal  = 0; // 0 = nevzvoní, 1 = signalizuje
+ /*
+  * Funkce: konz_cislice / konz_bcd2 / konz_hex2 / konz_znak_je
+  * -----------------------------------------------------------
+  * Čtení jedné číslice v rozsahu, dvou číslic jako BCD nejvýše 'max',
+  * dvou hexadecimálních číslic a očekávaného oddělovače.
+  * Návrat: 1 = přečteno (parser se posune), 0 = chyba
+  */
+ static uint8_t konz_cislice(uint8_t *v, uint8_t min, uint8_t max) {
+     uint8_t d = konz_znak() - '0';
+     if (d < min || d > max) {
+         return 0;
+     }
+     konz_dalsi();
+     *v = d;
+     return 1;
+ }
  
- // Mapa klávesnice 4×4: index podle aktivního
- // řádku (0–3) a detekovaného sloupce (0–3)
- const uint8_t mapa_klaves[4][4] = {
-     {  1,  4,  7, 14 },  // |(S13) 1|(S14) 4|(S15) 7|(S16) *|
-     {  2,  5,  8,  0 },  // |(S9)  2|(S10) 5|(S11) 8|(S12) 0|
-     {  3,  6,  9, 15 },  // |(S5)  3|(S6)  6|(S7)  9|(S8)  #|
-     { 10, 11, 12, 13 }   // |(S1)  A|(S2)  B|(S3)  C|(S4)  D|
- };
+ static uint8_t konz_bcd2(uint8_t *bcd, uint8_t max) {
+     uint8_t d, j;
+     if (!konz_cislice(&d, 0, 9) || !konz_cislice(&j, 0, 9)) {
+         return 0;
+     }
+     uint8_t v = (d << 4) | j;
+     if (v > max) {
+         return 0;
+     }
+     *bcd = v;
+     return 1;
+ }
  
- // Bitové vzory pro znaky 0–9, A–F a mezera na 7‑segmentu
- const uint8_t znaky[] = {
-     0b11000000,  // 0
-     0b11111001,  // 1
-     0b10100100,  // 2
-     0b10110000,  // 3
-     0b10011001,  // 4
-     0b10010010,  // 5
-     0b10000010,  // 6
-     0b11011000,  // 7
-     0b10000000,  // 8
-     0b10011000,  // 9
-     0b10001000,  // A
-     0b10000011,  // b
-     0b10100111,  // c
-     0b10110001,  // d
-     0b10000110,  // E
-     0b10001110,  // F
-     0b11111111   // mezera
- };
+ static uint8_t konz_hex2(uint8_t *v) {
+     uint8_t b = 0;
+     for (uint8_t k = 0; k < 2; k++) {
+         uint8_t c = konz_znak();
+         if (c >= '0' && c <= '9') {
+             c -= '0';
+         } else if ((c & ~0x20) >= 'A' && (c & ~0x20) <= 'F') {
+             c = (c & ~0x20) - 'A' + 10;
+         } else {
+             return 0;
+         }
+         konz_dalsi();
+         b = (b << 4) | c;
+     }
+     *v = b;
+     return 1;
+ }
  
- // Masky pro výběr pozice 1.–4. číslice při multiplexování
- const uint8_t poz[] = { 1, 2, 4, 8 };
+ static uint8_t konz_znak_je(uint8_t c) {
+     if (konz_znak() != c) {
+         return 0;
+     }
+     konz_dalsi();
+     return 1;
+ }
  
  /*
-  * Funkce: cti_klavesu
-  * -------------------
-  * Skenuje maticovou klávesnici 4×4.
-  * Postupně aktivuje jeden řádek (PORTC<0..3>=0), ostatní drží v log.1.
-  * Čte vstupní sloupce (PINC<4..7>) a pokud některý spadne na 0,
-  * vrátí odpovídající kód z mapy. Pokud není stisknuta žádná klávesa,
-  * vrací 99.
-  *
-  * Návrat: 0–15 kód klávesy, 99 = žádná klávesa
-  */
-uint8_t cti_klavesu(void) {
-    for (uint8_t r = 0; r < 4; r++) {          // cyklus přes všechny 4 řádky
-        PORTC = ~(1 << r);                     // aktivuje jeden řádek nastavením na 0, ostatní na 1
-        _delay_ms(1);                          // čekání 1ms na ustálení napětí
-        for (uint8_t s = 0; s < 4; s++) {      // cyklus přes všechny 4 sloupce
-            if ((~PINC) & (1 << (4 + s))) {    // testuje, zda je sloupec s aktivní (log.0)
-                return mapa_klaves[r][s];       // pokud ano, vrátí odpovídající kód z mapy kláves
-            }
-        }
-    }
-    return 99;                                 // žádná klávesa není stisknuta
-}
- 
- /*
-  * Funkce: cekej_na_pusteni
-  * ------------------------
-  * Zabraňuje vícenásobnému čtení jednoho stisku.
-  * Blokuje smyčku dokud je stisknuta klávesa.
+  * Funkce: konz_hhmm
+  * -----------------
+  * Přečte čas „hh:mm“ do c (sekundy nemění).
   */
- void cekej_na_pusteni(void) {
-     while (cti_klavesu() != 99) ;
+ static uint8_t konz_hhmm(cas_t *c) {
+     return konz_bcd2(&c->hodiny, 0x23) && konz_znak_je(':') && konz_bcd2(&c->minuty, 0x59);
  }
  
+ #ifdef PROFIL
  /*
-  * Funkce: zobraz_znak
+  * Funkce: konz_vypis_prof
+  * -----------------------
+  * Výpis profilování: min/max/průměr cyklů obou přerušení a histogramy
+  * průchodu smyčkou (LOOP) a zpoždění kláves (KEY).
+  */
+ static void konz_vypis_prof(void) {
+     static const char nazvy[PROF_ISR][6] PROGMEM = { "MUX ", "ZAKL " };
+     for (uint8_t i = 0; i < PROF_ISR; i++) {
+         uint16_t min, max, prumer;
+         prof_prerusni(i, &min, &max, &prumer);
+         konz_text(nazvy[i]);
+         konz_cislo(min);
+         konz_pis(' ');
+         konz_cislo(max);
+         konz_pis(' ');
+         konz_cislo(prumer);
+         konz_text(PSTR("\r\n"));
+     }
+     konz_text(PSTR("LOOP"));
+     for (uint8_t k = 0; k < PROF_KOSU; k++) {
+         konz_pis(' ');
+         konz_cislo(prof_smycka[k]);
+     }
+     konz_text(PSTR("\r\nKEY"));
+     for (uint8_t k = 0; k < PROF_KOSU; k++) {
+         konz_pis(' ');
+         konz_cislo(prof_klavesa[k]);
+     }
+     konz_text(PSTR("\r\n"));
+ }
+ #endif
+ 
+ /*
+  * Funkce: konz_den_tydne
+  * ----------------------
+  * Den v týdnu (0 = pondělí … 6 = neděle) k platnému datu d (BCD, 2000–2099)
+  * Sakamotovým vzorcem; dělí se jen při příkazu DATE.
+  */
+ const uint8_t konz_mesic_posun[12] PROGMEM = { 0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4 };
+ 
+ static uint8_t konz_den_tydne(const datum_t *d) {
+     uint8_t  m = (d->mesic >> 4) * 10 + (d->mesic & 0x0F);
+     uint16_t r = 2000 + (d->rok >> 4) * 10 + (d->rok & 0x0F) - (m < 3);
+     uint16_t n = r + r / 4 - r / 100 + r / 400 + pgm_read_byte(&konz_mesic_posun[m - 1])
+                + (d->den >> 4) * 10 + (d->den & 0x0F);
+     return (n + 6) % 7;   // vzorec dává 0 = neděle
+ }
+ 
+ /*
+  * Funkce: konz_prikaz
   * -------------------
-  * Zobrazí znak s indexem 'z' na 7‑segmentu na pozici 'p'.
-  * Data segmentů se zapíší na PORTA, výběr pozice na PORTD.
+  * Provede jeden příkaz konzole od pozice konz_i:
+  *   SET hh:mm:ss [d]       – nastavení času (a dne v týdnu 1–7)
+  *   DATE dd.mm.rr          – nastavení data (rok 2000 + rr), den v týdnu
+  *                            se dopočítá
+  * SET a DATE se během nastavování hodin z klávesnice odmítnou – odchod
+  * z režimu by je přepsal rozpracovanou kopií (uprava).
+  *   ALARM n [hh:mm mask]   – výpis/nastavení budíku 1–8, mask hexadecimálně
+  *                            (bit 0–6 = pondělí–neděle, bit 7 = aktivní)
+  *   GET                    – výpis času, dne v týdnu a data
+  *   STATS                  – provozní hodiny, statistiky konzole, korekce,
+  *                            zaseknuté klávesy (počet/maska), počty resetů
+  *                            (zapnutí/RESET/brown‑out/watchdog)
+  *   PROF [0]               – výpis (vynulování) profilování, jen s PROFIL
+  *   LOG                    – výpis záznamu událostí od nejstaršího, jen se ZAZNAM
+  * Návrat: 1 = provedeno, 0 = neplatný příkaz nebo parametry
   */
- void zobraz_znak(uint8_t p, uint8_t z) {
-     PORTA = znaky[z];    // nastavení segmentů
-     PORTD = ~poz[p];     // výběr pozice (aktivní low)
+ static uint8_t konz_prikaz(void) {
+     cas_t c;
+     konz_mezery();
+     uint8_t uprava_bezi = rezim_nastaveni == REZIM_NAST_HOD || rezim_nastaveni == REZIM_NAST_DAT;
+     if (konz_slovo(PSTR("SET"))) {
+         uint8_t den = den_tydne + 1;
+         konz_mezery();
+         if (!konz_hhmm(&c) || !konz_znak_je(':') || !konz_bcd2(&c.sekundy, 0x59)) {
+             return 0;
+         }
+         konz_mezery();
+         if (!konz_konec() && !konz_cislice(&den, 1, 7)) {
+             return 0;
+         }
+         konz_mezery();
+         if (!konz_konec() || uprava_bezi) {
+             return 0;
+         }
+         cas.hodiny = c.hodiny;
+         cas.minuty = c.minuty;
+         den_tydne  = den - 1;
+         uloz_cas();
+         cas.sekundy = c.sekundy;
+     } else if (konz_slovo(PSTR("DATE"))) {
+         datum_t d;
+         konz_mezery();
+         if (!konz_bcd2(&d.den, 0x31) || !konz_znak_je('.') || !konz_bcd2(&d.mesic, 0x12)
+             || !konz_znak_je('.') || !konz_bcd2(&d.rok, 0x99)) {
+             return 0;
+         }
+         konz_mezery();
+         if (!konz_konec() || d.den == 0 || d.mesic == 0 || d.den > datum_dni(&d) || uprava_bezi) {
+             return 0;
+         }
+         datum     = d;
+         den_tydne = konz_den_tydne(&d);
+         synchronizuj_minutu_tydne();
+         prepocitej_dalsi_budik();
+     } else if (konz_slovo(PSTR("ALARM"))) {
+         uint8_t n;
+         konz_mezery();
+         if (!konz_cislice(&n, 1, BUDIKU)) {
+             return 0;
+         }
+         budik_t *b = &budiky[n - 1];
+         konz_mezery();
+         if (konz_konec()) {
+             konz_text(PSTR("ALARM "));
+             konz_pis('0' + n);
+             konz_pis(' ');
+             konz_bcd(b->cas.hodiny);
+             konz_pis(':');
+             konz_bcd(b->cas.minuty);
+             konz_pis(' ');
+             konz_hex(b->dny);
+             konz_text(PSTR("\r\n"));
+             return 1;
+         }
+         uint8_t dny;
+         if (!konz_hhmm(&c) || !konz_znak_je(' ')) {
+             return 0;
+         }
+         konz_mezery();
+         if (!konz_hex2(&dny)) {
+             return 0;
+         }
+         konz_mezery();
+         if (!konz_konec()) {
+             return 0;
+         }
+         b->cas.hodiny = c.hodiny;
+         b->cas.minuty = c.minuty;
+         b->dny = dny;
+         budiky_zmeneny();
+         nastaveni_uloz();
+     } else if (konz_slovo(PSTR("GET"))) {
+         konz_mezery();
+         if (!konz_konec()) {
+             return 0;
+         }
+         konz_bcd(cas.hodiny);
+         konz_pis(':');
+         konz_bcd(cas.minuty);
+         konz_pis(':');
+         konz_bcd(cas.sekundy);
+         konz_pis(' ');
+         konz_pis('1' + den_tydne);
+         konz_pis(' ');
+         konz_bcd(datum.den);
+         konz_pis('.');
+         konz_bcd(datum.mesic);
+         konz_pis('.');
+         konz_bcd(datum.rok);
+         konz_text(PSTR("\r\n"));
+     } else if (konz_slovo(PSTR("STATS"))) {
+         konz_mezery();
+         if (!konz_konec()) {
+             return 0;
+         }
+         konz_text(PSTR("UP "));
+         konz_cislo(provoz_hodin);
+         konz_text(PSTR(" CMD "));
+         konz_cislo(konz_prikazy);
+         konz_text(PSTR(" ERR "));
+         konz_cislo(konz_chyby);
+         konz_text(PSTR(" DROP "));
+         konz_cislo(konz_rx_ztraty);
+         konz_pis('/');
+         konz_cislo(konz_tx_ztraty);
+         konz_text(PSTR(" PPM "));
+         konz_cislo_zn(korekce_ppm);
+         konz_text(PSTR(" EE "));
+         konz_cislo(nast_sekvence);
+         konz_text(PSTR(" STUCK "));
+         konz_cislo(klav_zaseknuti);
+         konz_pis('/');
+         konz_hex(klav_vadne >> 8);
+         konz_hex(klav_vadne);
+         konz_text(PSTR(" RST"));
+         for (uint8_t i = 0; i < RESET_PRICIN; i++) {
+             konz_pis(i ? '/' : ' ');
+             konz_cislo(tepla_kopie.resety[i]);
+         }
+ #ifdef SYNC
+         konz_text(PSTR(" SYNC "));
+         konz_cislo(sync_chyby);
+ #ifdef SYNC_SLAVE
+         konz_pis('/');
+         konz_cislo(sync_skoky);
+ #endif
+ #endif
+         konz_text(PSTR("\r\n"));
+ #ifdef PROFIL
+     } else if (konz_slovo(PSTR("PROF"))) {
+         konz_mezery();
+         uint8_t nulovat = konz_znak_je('0');
+         konz_mezery();
+         if (!konz_konec()) {
+             return 0;
+         }
+         if (nulovat) {
+             // PROF 0 – vynulování statistik
+             ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                 memset(prof_isr, 0, sizeof(prof_isr));
+             }
+             memset(prof_smycka, 0, sizeof(prof_smycka));
+             memset(prof_klavesa, 0, sizeof(prof_klavesa));
+         } else {
+             konz_vypis_prof();
+         }
+ #endif
+ #ifdef ZAZNAM
+     } else if (konz_slovo(PSTR("LOG"))) {
+         konz_mezery();
+         if (!konz_konec()) {
+             return 0;
+         }
+         zaz_vypis = 1;  // vypisuje se po částech v konz_vypis_zaznam()
+ #endif
+     } else {
+         return 0;
+     }
+     aktualizuj_displej();
+     return 1;
  }
  
+ #ifdef ZAZNAM
  /*
-  * ISR(TIMER0_OVF_vect)
-  * --------------------
-  * Přerušení od přetečení časovače0 (cca 1 kHz multiplexu).
-  * Obsluhuje multiplexování 4 číslic na 7‑segmentu.
-  * Podle režimu (normál nebo nastavení budíku) volí hodnotu digit.
+  * Funkce: konz_vypis_zaznam
+  * -------------------------
+  * Pokračuje ve výpisu LOG, dokud se řádky vejdou do konz_tx[]: každý
+  * záznam jako 8 šestnáctkových číslic (typ, data, hodnota), na konci
+  * „LOST n“ (zahozené záznamy) a „OK“. Záznamy v EEPROM se čtou, až
+  * doběhne zápis na pozadí; nové dávky se během výpisu nezapisují.
+  *
+  * Návrat: 1 = výpis skončil, 0 = pokračuje při dalším průchodu
   */
- ISR(TIMER0_OVF_vect) {
-     static uint8_t i = 0;
-     uint8_t digit;
- 
-    if (rezim_nastaveni == REZIM_NAST_BUD) {
-        // v režimu budíku zobrazujeme budik_minuty/hodiny
-        if (i < 2) {
-           if (i == 0) {
-              digit = budik_minuty % 10;
-           } else {
-              digit = (budik_minuty / 10) % 10;
-           }
-        } else {
-           if (i == 2) {
-              digit = budik_hodiny % 10;
-           } else {
-              digit = (budik_hodiny / 10) % 10;
-           }
-        }
-    } else {
-        // v normálu nebo při nastavování hodin zobrazujeme minuty/hodiny
-        if (i < 2) {
-           if (i == 0) {
-              digit = minuty % 10;
-           } else {
-              digit = (minuty / 10) % 10;
-           }
-        } else {
-           if (i == 2) {
-              digit = hodiny % 10;
-           } else {
-              digit = (hodiny / 10) % 10;
-           }
-        }
-    }
- 
-     zobraz_znak(i, digit);
-     i = (i + 1) & 3;  // cyklicky 0 → 1 → 2 → 3 → 0
+ static uint8_t konz_vypis_zaznam(void) {
+     if (ee_zbyva || zaz_zapisuje || (EECR & (1 << EEWE))) {
+         return 0;
+     }
+     while ((uint8_t)(konz_tx_cteni - konz_tx_zapis - 1) >= 16) {
+         uint8_t i = zaz_vypis - 1;
+         if (i == ZAZ_EEPROM + ZAZ_RAM) {
+             konz_text(PSTR("LOST "));
+             konz_cislo(zaz_ztraty);
+             konz_text(PSTR("\r\nOK\r\n"));
+             zaz_vypis = 0;
+             return 1;
+         }
+         zaz_vypis++;
+         zaznam_t z;
+         if (zaznam_cti(i, &z)) {
+             konz_hex(z.typ);
+             konz_hex(z.data);
+             konz_hex(z.hodnota >> 8);
+             konz_hex(z.hodnota);
+             konz_text(PSTR("\r\n"));
+         }
+     }
+     return 0;
  }
+ #endif
  
  /*
-  * ISR(TIMER1_COMPA_vect)
+  * Funkce: obsluz_konzoli
   * ----------------------
-  * Přerušení od Compare Match A časovače1 – generuje přesnou 1 Hz.
-  * Na jede výstupní LED3 (PB3) toggluje stav_led a nastaví
-  * příznak sekunda_uplynula pro hlavní smyčku.
+  * Zpracuje všechny řádky přijaté od minulého volání, každý odpoví „OK“
+  * nebo „ERR“. Místo řádku v konz_rx[] se uvolní až po jeho zpracování.
   */
- ISR(TIMER1_COMPA_vect) {
-     sekunda_uplynula = 1;      // signalizuj hlavní smyčce
-     stav_led         = !stav_led;
- }
+ void obsluz_konzoli(void) {
+ #ifdef ZAZNAM
+     if (zaz_vypis && !konz_vypis_zaznam()) {
+         return;  // další příkazy počkají na dokončení výpisu LOG
+     }
+ #endif
+     while (konz_radky_zpracovane != konz_radky) {
+         konz_radky_zpracovane++;
+         konz_i = konz_rx_cteni;
+         uint8_t ok = konz_prikaz();
+         while (!konz_konec()) {
+             konz_dalsi();  // zbytek řádku po chybě
+         }
+         if (konz_znak() == KONZ_PRETEKL) {
+             ok = 0;
+         }
+         konz_dalsi();
+         konz_rx_cteni = konz_i;
  
- int main(void) {
-     // --- Inicializace portů ---
-     DDRA = 0xFF;            // PORTA[0..7] = výstup pro segmenty
-     DDRD = 0x0F;            // PORTD[0..3] = výstup pro pozice
-     DDRC = 0x0F;            // PORTC[0..3] = řádky klávesnice
-     PORTC = 0xFF;           // pull‑up na sloupcích klávesnice
-     DDRB |= 0x0F;           // PB0–PB3 = výstupy pro LED (aktivní low)
-     PORTB |= 0x0F;          // inicialně všechny LED zhasnuté (1)
+         konz_prikazy++;
+ #ifdef ZAZNAM
+         if (ok && zaz_vypis) {
+             konz_vypis_zaznam();  // „OK“ až po posledním záznamu
+             return;
+         }
+ #endif
+         if (ok) {
+             konz_text(PSTR("OK\r\n"));
+         } else {
+             konz_chyby++;
+             konz_text(PSTR("ERR\r\n"));
+         }
+     }
+ }
+ #endif
  
-     // --- Inicializace Timer0 pro multiplexování ---
-     TCCR0  = (1 << CS02);   // prescaler = 256
-     TIMSK |= (1 << TOIE0);  // povolit přerušení při přetečení
+ /*
+  * Funkce: obsluz_sekundu
+  * ----------------------
+  * Běh času a kontrola budíku, volá se jednou za každou sekundu
+  * napočítanou ISR(TIMER1_COMPA_vect).
+  */
+ void obsluz_sekundu(void) {
+     SIM_POCET(SIM_SEKUNDA);
+ #ifdef KONZOLE
+     static uint16_t provoz_sekund = 0;
+     if (++provoz_sekund == 3600) {
+         provoz_sekund = 0;
+         provoz_hodin++;
+     }
+ #endif
+     if (budik_signal && zvoneni_sekund < 255) {
+         zvoneni_sekund++;  // naléhavost rytmu bzučáku
+     }
+ #ifdef ZAZNAM
+     if (zaz_sekund < 255) {
+         zaz_sekund++;      // přestávka v záznamu událostí
+     }
+ #endif
+ #ifdef ZAKLADNA_RTC
+     // v úsporném režimu neběží sken klávesnice – jednou za sekundu se
+     // zkontroluje, zda není stisknuta libovolná klávesa
+     if (bdeni_sekund) {
+         bdeni_sekund--;
+     } else if (displej_vypnut && klav_libovolna()) {
+         bdeni_sekund = BDENI_SEKUND;
+     }
+ #endif
  
-     // --- Inicializace Timer1 pro 1 Hz taktování ---
-     TCCR1B = (1 << WGM12)   // CTC režim
-            | (1 << CS12)    // prescaler = 1024
-            | (1 << CS10);
-     OCR1A = 15624;          // 16 MHz/1024/15625 ≈ 1 Hz
-     TIMSK |= (1 << OCIE1A); // povolit Compare Match A
+     // nová sekunda – stav_led se změnil, vzory LED začínají od prvního kroku;
+     // běžící kroky rytmu se srovnají se sekundou, jinak by první krok trval
+     // jen zbytek kroku spuštěného kdykoli během sekundy
+     led_faze    = 0;
+     led_obnovit = 1;
+     if (casovace[CAS_KROK].bezi) {
+         casovac_spust(CAS_KROK, KROK_MS, KROK_MS);
+     }
+
+     // odpočet zprávy na displeji (posouvaná zpráva se odpočítává až od konce)
+     if (zprava_sekund && !casovace[CAS_ZPRAVA].bezi && --zprava_sekund == 0) {
+         aktualizuj_displej();
+     }
  
-     sei(); // povolení globálních přerušení
+ #ifndef ZAKLADNA_RTC
+     // dokončené měření krystalu – výsledek se stane novou korekcí
+     if (mereni_stav == MERENI_HOTOVO) {
+         mereni_zastav();
+         nastav_korekci(mereni_vysledek());
+     }
+ #endif
+     if (rezim_nastaveni == REZIM_KALIBRACE && mereni_stav != MERENI_NECINNE) {
+         aktualizuj_displej();  // odpočet pulzů
+     }
+     if (obraz_blik | obraz_tecky) {
+         zverejni_snimek();     // nová fáze blikání kurzoru a dvojtečky, obraz se neskládá
+     }
  
-     // --- Hlavní smyčka programu ---
-     while (1) {
-         // 1) Čtení klávesy a zrušení signalizace budíku
-         z_klavesa = cti_klavesu();
-         if (budik_signal && z_klavesa != 99) {
-             // jakákoli klávesa během zvonění vypne alarm
-             budik_signal = 0;
-             cekej_na_pusteni();
-         }
- 
-         // 2) Přepnutí/režim nastavení hodin (klávesa C = 12)
-         if (z_klavesa == 12) {
-             if (rezim_nastaveni == REZIM_NORMAL) {
-                 rezim_nastaveni = REZIM_NAST_HOD;
-             } else if (rezim_nastaveni == REZIM_NAST_HOD) {
-                 // uložení hodin, návrat do normálu, vynulování sekund
-                 rezim_nastaveni = REZIM_NORMAL;
-                 sekundy = 0;
+     // zvýšení sekund s přenosem do minut a hodin
+     uint8_t zmena = cas_tick(&cas);
+     if (zmena) {
+         if (zmena & CAS_DEN) {
+             if (++den_tydne == 7) {
+                 den_tydne = 0;
              }
-             cekej_na_pusteni();
+             datum_dalsi_den(&datum);
+         }
+ #ifdef SYNC_MASTER
+         sync_vysli();          // rámec s časem pro ostatní hodiny co nejdřív po začátku minuty
+ #endif
+         if (++minuta_tydne == MINUT_TYDNE) {
+             minuta_tydne = 0;
+         }
+         if (rezim_nastaveni != REZIM_NAST_HOD && rezim_nastaveni != REZIM_NAST_DAT) {
+             aktualizuj_displej();  // zobrazení se mění jen jednou za minutu (při úpravě času vůbec)
+         }
+ 
+         // spuštění alarmu v přesný čas (sekundy == 0) – jediné porovnání
+         // s předpočítaným nejbližším budíkem
+         if (minuta_tydne == dalsi_budik || minuta_tydne == budik_odlozen) {
+             zvonek_udalost(UD_BUDIK);
+             prepocitej_dalsi_budik();
+         } else if (budik_signal && ++zvoneni_minut == AUTO_TICHO_MINUT) {
+             zvonek_udalost(UD_TICHO);
+         }
+     } else if (rezim_nastaveni == REZIM_NORMAL && pohled == POHLED_SEKUNDY) {
+         aktualizuj_displej();  // pohled MM.SS se mění každou sekundu
+     }
+ }
+ 
+ /*
+  * Funkce: led_vyber
+  * -----------------
+  * Deklarativní model LED: ze stavu hodin vybere vzor každé LED.
+  *    PB3: sekundová indikace (bliká se stav_led), rychle bliká, dokud
+  *         se nepotvrdí klávesou poškozené nastavení v EEPROM, dvojitě
+  *         bliká, je-li některá klávesa zaseknutá
+  *    PB2: režim nastavování hodin a data
+  *    PB1: režim nastavování budíku
+  *    PB1 + PB2: kalibrace krystalu
+  *    PB0: signalizace budíku (bliká se stav_led, při odložení dvojitě bliká)
+  * Volá se jen po událostech; při změně vzorů vyžádá přepočet úrovně.
+  */
+ void led_vyber(void) {
+     uint8_t v[LED_POCET] = { LED_ZHASNUTA, LED_ZHASNUTA, LED_ZHASNUTA, LED_ZHASNUTA };
+ 
+     v[PB3] = nast_poskozeno ? LED_RYCHLE : (klav_vadne ? LED_DVOJBLIK : LED_BLIK);
+     if (budik_signal) {
+         v[PB0] = LED_BLIK;  // při zvonění se indikace režimů nezobrazují
+     } else {
+         if (zvonek_stav == ZVONEK_ODLOZENO) {
+             v[PB0] = LED_DVOJBLIK;
          }
+         if (rezim_nastaveni == REZIM_NAST_HOD || rezim_nastaveni == REZIM_NAST_DAT
+             || rezim_nastaveni == REZIM_KALIBRACE) {
+             v[PB2] = LED_SVITI;
+         }
+         if (rezim_nastaveni == REZIM_NAST_BUD || rezim_nastaveni == REZIM_KALIBRACE) {
+             v[PB1] = LED_SVITI;
+         }
+     }
  
-         // 3) Přepnutí/režim nastavení budíku (klávesa D = 13)
-         if (z_klavesa == 13) {
-             if (rezim_nastaveni == REZIM_NORMAL) {
-                 rezim_nastaveni = REZIM_NAST_BUD;
-             } else if (rezim_nastaveni == REZIM_NAST_BUD) {
-                 // uložení budíku, aktivace alarmu
-                 rezim_nastaveni = REZIM_NORMAL;
-                 budik_aktivni = 1;
+     if (memcmp(v, led_vzor, sizeof(v)) != 0) {
+         memcpy(led_vzor, v, sizeof(v));
+         led_kroky = 0;
+         for (uint8_t i = 0; i < LED_POCET; i++) {
+             if (LED_KROKOVY(v[i])) {
+                 led_kroky = 1;
              }
-             cekej_na_pusteni();
          }
+         led_obnovit = 1;
+     }
+ }
  
-         // 4) Inkrementace hodin/minut dle aktivního režimu
-         if (rezim_nastaveni == REZIM_NAST_HOD) {
-             if (z_klavesa == 10) {        // A – hodiny
-                 hodiny = (hodiny + 1) % 24;
-                 cekej_na_pusteni();
+ /*
+  * Funkce: led_krok
+  * ----------------
+  * Krok rytmu (125 ms) – posune fázi vzorů LED. Přepočet úrovně je
+  * potřeba jen tehdy, když se některý vzor mění i mezi sekundami.
+  */
+ static inline void led_krok(void) {
+     if (led_faze < RYTMUS_KROKU - 1) {
+         led_faze++;
+     }
+     if (led_kroky) {
+         led_obnovit = 1;
+     }
+ }
+ 
+ /*
+  * Funkce: obsluz_led
+  * ------------------
+  * Z vybraných vzorů a aktuální fáze spočítá úroveň LED (aktivní úroveň
+  * podle desky) a zapíše ji do PORTB, jen pokud se změnila.
+  */
+ void obsluz_led(void) {
+     if (!led_obnovit) {
+         return;
+     }
+     led_obnovit = 0;
+ 
+     uint16_t bit = 1u << ((stav_led ? RYTMUS_KROKU : 0) + led_faze);
+     uint8_t u = deska::led::uroven(0);
+     for (uint8_t i = 0; i < LED_POCET; i++) {
+         if (pgm_read_word(&led_vzory[led_vzor[i]]) & bit) {
+             u = deska::led::aktivuj(u, 1 << i);
+         }
+     }
+     if (u != led_uroven) {
+         // pouze spodní 4 bity PORTB (LED), horní 4 bity zůstanou beze změny
+         led_uroven = u;
+ #ifdef SYNC
+         ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {  // PB6/PB7 mezitím přepíná sken klávesnice
+             deska::led::zapis(u);
+         }
+ #else
+         deska::led::zapis(u);
+ #endif
+         SIM_POCET(SIM_LED);
+     }
+ }
+ 
+ /*
+  * Funkce: bzucak_krok
+  * -------------------
+  * Sekvencer rytmu bzučáku: za každý krok rytmu (časovač CAS_KROK,
+  * krok_rytmu) posune pozici v rytmu, na začátku rytmu vybere stupeň naléhavosti podle
+  * doby zvonění.
+  */
+ static inline void bzucak_krok(void) {
+     if (!budik_signal) {
+         rytmus_krok = 0;
+         rytmus_vzor = 0;
+         return;
+     }
+     if (rytmus_krok == 0) {
+         uint8_t u = 0;
+         while (u < URGENCI - 1 && zvoneni_sekund >= pgm_read_byte(&urgence_od[u])) {
+             u++;
+         }
+         rytmus_vzor = pgm_read_byte(&rytmus[u]);
+     }
+     rytmus_krok = (rytmus_krok + 1) & (RYTMUS_KROKU - 1);
+     rytmus_vzor = (rytmus_vzor >> 1) | (rytmus_vzor << 7);  // rotace – bit 0 je aktuální krok
+ }
+ 
+ /*
+  * Funkce: obsluz_bzucak
+  * ---------------------
+  * Zapne/vypne tón podle aktuálního kroku rytmu, jen při změně. Po zrušení
+  * budik_signal se tón vypne hned při nejbližším průchodu smyčkou.
+  */
+ void obsluz_bzucak(void) {
+     uint8_t zapnout = budik_signal && (rytmus_vzor & 0x80);  // bit aktuálního kroku je po rotaci v bitu 7
+     if (zapnout != bzucak_zapnut) {
+         bzucak_zapnut = zapnout;
+         bzucak_ton(zapnout);
+     }
+ }
+ 
+ /*
+  * Funkce: krok_rytmu
+  * ------------------
+  * Obsluha časovače CAS_KROK (každých KROK_MS): posune sekvencer bzučáku
+  * a vzory LED.
+  */
+ static void krok_rytmu(void) {
+     bzucak_krok();
+     led_krok();
+ }
+ 
+ /*
+  * Funkce: klav_opakuj
+  * -------------------
+  * Obsluha časovače CAS_OPAKOVANI: ohlásí opakování držené klávesy
+  * a naplánuje další – prvních KLAV_ZRYCHLENI v intervalu KLAV_OPAK,
+  * pak rychleji v KLAV_OPAK_RYCHLE.
+  */
+ static void klav_opakuj(void) {
+     obsluz_klavesu(opak_klavesa | KLAV_OPAKOVANI);
+     if (opak_pocet < KLAV_ZRYCHLENI) {
+         opak_pocet++;
+         casovac_spust(CAS_OPAKOVANI, KLAV_OPAK, 0);
+     } else {
+         casovac_spust(CAS_OPAKOVANI, KLAV_OPAK_RYCHLE, 0);
+     }
+ }
+ 
+ /*
+  * Funkce: klav_opakovani
+  * ----------------------
+  * Sleduje události klávesnice kvůli automatickému opakování: stisk klávesy
+  * z KLAV_OPAK_MASKA spustí po KLAV_PRODLEVA opakování, puštění této klávesy
+  * nebo stisk jiné klávesy ho ukončí.
+  */
+ static void klav_opakovani(uint8_t udalost) {
+     if (udalost & KLAV_PUSTENI) {
+         if ((udalost & ~KLAV_PUSTENI) != opak_klavesa) {
+             return;
+         }
+     } else if (udalost < 16 && ((1u << udalost) & KLAV_OPAK_MASKA)) {
+         opak_klavesa = udalost;
+         opak_pocet   = 0;
+         casovac_spust(CAS_OPAKOVANI, KLAV_PRODLEVA, 0);
+         return;
+     }
+     opak_klavesa = KLAV_ZADNA;
+     casovac_zastav(CAS_OPAKOVANI);
+ }
+ 
+ /*
+  * Funkce: klav_sleduj
+  * -------------------
+  * Vede masku držených kláves podle událostí z fronty (akord C+D jeho
+  * klávesy uvolní, jejich puštění ISR nehlásí). Puštění zaseknuté klávesy
+  * ji znovu povolí a samo se zahodí – stisk se obsloužil už před vyřazením
+  * a C/D by při puštění přepnuly režim.
+  *
+  * Návrat: 1 = událost se obslouží, 0 = zahodit
+  */
+ static uint8_t klav_sleduj(uint8_t udalost) {
+     if (udalost == KLAV_AKORD_CD) {
+         klav_drzene &= ~KLAV_AKORD_MASKA;
+         return 1;
+     }
+     uint8_t  kod = udalost & ~KLAV_PUSTENI;
+     uint16_t bit = 1u << kod;
+     if (!(udalost & KLAV_PUSTENI)) {
+         klav_drzene |= bit;
+         klav_drzeni[kod] = 0;
+         return 1;
+     }
+     klav_drzene &= ~bit;
+     if (klav_vadne & bit) {
+         ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+             klav_vadne &= ~bit;
+         }
+         return 0;
+     }
+     return 1;
+ }
+ 
+ /*
+  * Funkce: klav_hlidej
+  * -------------------
+  * Jednou za sekundu prodlouží dobu držení držených kláves; klávesu
+  * drženou KLAV_ZASEKNUTI_SEK vyřadí jako zaseknutou (ukončí i její
+  * opakování) a započítá do klav_zaseknuti.
+  */
+ static void klav_hlidej(void) {
+     uint16_t drzene = klav_drzene & ~klav_vadne;
+     for (uint8_t k = 0; drzene; k++, drzene >>= 1) {
+         if ((drzene & 1) && ++klav_drzeni[k] == KLAV_ZASEKNUTI_SEK) {
+             ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                 klav_vadne |= 1u << k;
+             }
+             if (klav_zaseknuti < 255) {
+                 klav_zaseknuti++;
              }
-             if (z_klavesa == 11) {        // B – minuty
-                 minuty = (minuty + 1) % 60;
-                 cekej_na_pusteni();
+             if (opak_klavesa == k) {
+                 klav_opakovani(k | KLAV_PUSTENI);
              }
          }
-         if (rezim_nastaveni == REZIM_NAST_BUD) {
-             if (z_klavesa == 10) {        // A – hodiny budíku
-                 budik_hodiny = (budik_hodiny + 1) % 24;
-                 cekej_na_pusteni();
+     }
+ }
+ 
+ // Obsluhy časovačů podle CAS_* (ukazatele ve flash – čtou se jen při vypršení)
+ typedef void (*casovac_obsluha_t)(void);
+ const casovac_obsluha_t casovac_obsluhy[CASOVACU] PROGMEM = {
+     krok_rytmu,       // CAS_KROK
+     klav_opakuj,      // CAS_OPAKOVANI
+     nastaveni_uloz,   // CAS_ULOZENI
+     posun_zpravy,     // CAS_ZPRAVA
+ #ifdef SVETLO
+     svetlo_krok,      // CAS_SVETLO
+ #endif
+ };
+ 
+ /*
+  * Funkce: obsluz_casovace
+  * -----------------------
+  * Dožene tiky napočítané ISR a zavolá obsluhy vypršených časovačů.
+  * Periodický časovač se znovu zařadí ještě před obsluhou, může ho tedy
+  * zastavit nebo přeplánovat. Pro každý tik se projde jen jeho slot.
+  *
+  * Návrat: 1 = vypršel některý časovač, 0 = žádný
+  */
+ static uint8_t obsluz_casovace(void) {
+     uint8_t vyprsel = 0;
+     while (casovace_cekaji()) {
+         tiky_zpracovane++;
+         tik++;
+         uint8_t id = kolo[(uint8_t)tik & (KOLO_SLOTU - 1)];
+         while (id != CASOVAC_ZADNY) {
+             casovac_t *c = &casovace[id];
+             if (c->vyprseni != tik) {
+                 id = c->dalsi;   // patří do pozdějšího oběhu kola
+                 continue;
              }
-             if (z_klavesa == 11) {        // B – minuty budíku
-                 budik_minuty = (budik_minuty + 1) % 60;
-                 cekej_na_pusteni();
+             casovac_vyjmi(id);
+             if (c->perioda) {
+                 casovac_vloz(id, c->vyprseni + c->perioda);
              }
+             SIM_POCET(SIM_CASOVAC);
+             ((casovac_obsluha_t)pgm_read_ptr(&casovac_obsluhy[id]))();
+             vyprsel = 1;
+             id = kolo[(uint8_t)tik & (KOLO_SLOTU - 1)];  // obsluha mohla slot změnit
          }
+     }
+     return vyprsel;
+ }
  
-         // 5) Běh času a kontrola budíku každou sekundu
-         if (sekunda_uplynula) {
-             // zvýšení sekund
-             sekundy++;
-             if (sekundy > 59) {
-                 sekundy = 0;
-                 // přetečení minut
-                 if (++minuty > 59) {
-                     minuty = 0;
-                     hodiny = (hodiny + 1) % 24;
-                 }
-             }
-             // spuštění alarmu v přesný čas (sekundy == 0)
-             if (budik_aktivni && !budik_signal &&
-                 hodiny == budik_hodiny &&
-                 minuty == budik_minuty &&
-                 sekundy == 0) {
-                 budik_signal = 1;
+ /*
+  * Funkce: cekej_na_udalost
+  * ------------------------
+  * Uspí CPU (SLEEP_MODE_IDLE), dokud některé přerušení nevloží událost –
+  * klávesu do fronty nebo další sekundu do sekundy_isr. S RTC základnou
+  * a vypnutým displejem spí v SLEEP_MODE_PWR_SAVE, kdy běží jen Timer2
+  * (pokud nezvoní budík, neběží žádný softwarový časovač a neprobíhá
+  * zápis do EEPROM, jehož přerušení by CPU z tohoto režimu neprobudilo, ani
+  * se nevysílá rámec TWI; s konzolí se nepoužívá, USART
+  * v něm stojí). Podmínka se testuje
+  * se zakázanými přerušeními a sei() těsně před sleep_cpu() zaručí, že se
+  * přerušení přijaté mezi testem a uspáním neztratí (instrukce po sei se
+  * vždy provede ještě před obsluhou přerušení). V SLEEP_MODE_PWR_SAVE se
+  * před každým uspáním čeká na dokončení asynchronního zápisu OCR2.
+  * Multiplex (Timer0) CPU budí 2 × MUX_HZ za sekundu, ale po každém takovém
+  * probuzení bez události se CPU okamžitě znovu uspí. Událostí je i tik,
+  * v jehož slotu kola leží běžící časovač (krok rytmu, opakování klávesy,
+  * odložené uložení).
+  */
+ static void cekej_na_udalost(void) {
+ #if defined(ZAKLADNA_RTC) && !defined(KONZOLE)
+     uint8_t uspora = displej_vypnut && !budik_signal && casovacu_bezi == 0 && !bdeni_sekund && ee_zbyva == 0
+ #ifdef SYNC_MASTER
+         && sync_stav == SYNC_VOLNO  // TWI v úsporném režimu stojí
+ #endif
+         ;
+     set_sleep_mode(uspora ? SLEEP_MODE_PWR_SAVE : SLEEP_MODE_IDLE);
+ #endif
+     cli();
+     while (klav_cteni == klav_zapis && sekundy_isr == sekundy_zpracovane
+ #ifdef KONZOLE
+            && konz_radky == konz_radky_zpracovane
+ #endif
+ #if defined(KONZOLE) && defined(ZAZNAM)
+            && !zaz_vypis       // výpis LOG pokračuje každým průchodem smyčky
+ #endif
+ #ifdef SYNC_SLAVE
+            && sync_stav != SYNC_PRIJATO
+ #endif
+            && !casovace_cekaji()) {
+ #if defined(ZAKLADNA_RTC) && !defined(KONZOLE)
+         if (uspora) {
+             // před každým uspáním (i po probuzení od první půlsekundy bez
+             // události) musí být dokončen zápis do registru Timer2, jinak
+             // by se CPU z úsporného režimu znovu neprobudilo; zápis OCR2
+             // z ISR se dočká, jinak se zapíše stejná hodnota naprázdno
+             if (!(ASSR & (1 << OCR2UB))) {
+                 OCR2 = OCR2;
              }
-             sekunda_uplynula = 0;
+             while (ASSR & (1 << OCR2UB)) ;
          }
+ #endif
+         sleep_enable();
+         sei();
+         sleep_cpu();
+         sleep_disable();
+         cli();
+     }
+     sei();
+ }
  
-         // 6) Výpočet a zobrazení stavu LED (aktivní low)
-         //    PB3: sekundová indikace (stav_led toggluje 1 Hz)
-         //    PB2: režim nastavování hodin
-         //    PB1: režim nastavování budíku
-         //    PB0: signalizace budíku (bliká 1 Hz)
-         // Výchozí hodnota pro LED - všechny LED jsou vypnuté (log.1, protože jsou aktivní v log.0)
-         uint8_t led_out = 0x0F;  // 0b00001111
-
-         // Pokud je stav_led=1 (každou druhou sekundu), rozsvítí LED na PB3 (sekundová indikace)
-         if (stav_led) {
-             led_out &= ~(1 << PB3);  // Vynuluje bit PB3, ostatní bity zachová
+ /*
+  * Funkce: tepla_crc / tepla_uloz
+  * ------------------------------
+  * CRC kopie pro teplý restart a její obnovení z aktuálního stavu
+  * (několik bajtů, volá se z hlavní smyčky po každé události).
+  */
+ static uint16_t tepla_crc(void) {
+     const uint8_t *p = (const uint8_t *)&tepla_kopie;
+     uint16_t crc = 0xFFFF;
+     for (uint8_t i = 0; i < offsetof(tepla_kopie_t, crc); i++) {
+         crc = _crc16_update(crc, p[i]);
+     }
+     return crc;
+ }
+ 
+ static void tepla_uloz(void) {
+     tepla_kopie.cas           = cas;
+     tepla_kopie.datum         = datum;
+     tepla_kopie.den_tydne     = den_tydne;
+     tepla_kopie.zvonek_stav   = zvonek_stav;
+     tepla_kopie.budik_odlozen = budik_odlozen;
+     tepla_kopie.crc           = tepla_crc();
+ }
+ 
+ /*
+  * Funkce: teply_start
+  * -------------------
+  * Vyhodnotí příčinu resetu (MCUCSR), započítá ji a po resetu od watchdogu
+  * nebo brown‑outu s platnou kopií obnoví čas, datum, den v týdnu a stav
+  * zvonění (zvonící budík zvoní znovu, odložený zůstane odložený).
+  * Nastavení (budíky, jas, korekce, stav kruhu slotů) pak převezme
+  * z nast_tepla a sloty EEPROM vůbec nečte; jen při studeném startu nebo
+  * neplatné kopii nastaví výchozí budíky a načte nastavení z EEPROM.
+  * Zbylá inicializace (porty, časovače) je nutná i po teplém restartu –
+  * reset vynuluje registry periferií – a trvá jen mikrosekundy.
+  */
+ static void teply_start(void) {
+     uint8_t priznaky = MCUCSR;
+     MCUCSR = priznaky & ~((1 << PORF) | (1 << EXTRF) | (1 << BORF) | (1 << WDRF));
+ 
+     uint8_t platna = tepla_kopie.crc == tepla_crc();
+     if (!platna) {
+         memset(tepla_kopie.resety, 0, sizeof(tepla_kopie.resety));
+     }
+     uint8_t pricina = RESET_PRICIN;
+     if (priznaky & (1 << PORF)) {
+         pricina = RESET_ZAPNUTI;
+     } else if (priznaky & (1 << WDRF)) {
+         pricina = RESET_WATCHDOG;
+     } else if (priznaky & (1 << BORF)) {
+         pricina = RESET_BROWNOUT;
+     } else if (priznaky & (1 << EXTRF)) {
+         pricina = RESET_EXTERNI;
+     }
+     if (pricina < RESET_PRICIN && tepla_kopie.resety[pricina] < 255) {
+         tepla_kopie.resety[pricina]++;
+     }
+ 
+     restart_teply = platna && (pricina == RESET_WATCHDOG || pricina == RESET_BROWNOUT);
+     if (!restart_teply || !nastaveni_obnov()) {
+         for (uint8_t k = 0; k < BUDIKU; k++) {
+             budiky[k].dny = BUDIK_VSECHNY_DNY;  // nový budík platí pro všechny dny
          }
+         nastaveni_nacti();   // budíky a jas z EEPROM (pokud jsou uložené)
+     }
+     budiky_zmeneny();
+ #ifdef ZAZNAM
+     zaznam_start(pricina | (restart_teply << 7));
+ #endif
+     if (restart_teply) {
+         cas       = tepla_kopie.cas;
+         datum     = tepla_kopie.datum;
+         den_tydne = tepla_kopie.den_tydne;
+         synchronizuj_minutu_tydne();
+         prepocitej_dalsi_budik();
+         if (tepla_kopie.zvonek_stav == ZVONEK_ZVONI) {
+             zvonek_udalost(UD_BUDIK);
+         } else if (tepla_kopie.zvonek_stav == ZVONEK_ODLOZENO) {
+             zvonek_stav   = ZVONEK_ODLOZENO;
+             budik_odlozen = tepla_kopie.budik_odlozen;
+         }
+     }
+     tepla_uloz();
+ }
+ 
+ /*
+  * Funkce: inicializace
+  * --------------------
+  * Nastavení portů, časovačů a periferií, načtení nastavení z EEPROM
+  * (po teplém restartu z .noinit), spuštění watchdogu a povolení přerušení.
+  */
+ void inicializace(void) {
+     // --- Inicializace portů ---
+     deska::segmenty::vystup();        // PORTA[0..7] = výstup pro segmenty
+     deska::pozice::zapis_port(0);     // žádná pozice nevybrána
+     deska::pozice::vystup();          // PORTD[0..3] (s konzolí PD2–PD5/PD6) = výstup pro pozice
+ #ifdef SYNC
+     deska::klavesnice::ddr()  = 0x0C; // PORTC[2..3] = řádky 3 a 4, PC0/PC1 = SCL/SDA
+     deska::klavesnice_sync::port() |= 0xC0;  // řádky 1 a 2 neaktivní
+     deska::klavesnice_sync::ddr()  |= 0xC0;  // PB6/PB7 = řádky 1 a 2 klávesnice
+ #else
+     deska::klavesnice::ddr()  = 0x0F; // PORTC[0..3] = řádky klávesnice
+ #endif
+     deska::klavesnice::port() = 0xFF; // pull‑up na sloupcích klávesnice (se SYNC i na SCL/SDA)
+     deska::led::zapis(deska::led::uroven(0));  // inicialně všechny LED zhasnuté
+     deska::led::vystup();             // PB0–PB3 = výstupy pro LED
+ 
+     // --- Inicializace Timer0 pro multiplexování ---
+     OCR0   = MUX_ZATEMNENI - 1;       // první fáze je zatemnění
+     TCCR0  = (1 << WGM01) | MUX_CS;   // CTC režim, předdělička dle OBNOVA_HZ
+     TIMSK |= (1 << OCIE0);            // povolit Compare Match
+ 
+ #ifdef ZAKLADNA_RTC
+     deska::klavesnice_rtc::port() |= 0x30;  // pull‑up na sloupcích 3 a 4 klávesnice (PB4, PB5)
+ #endif
+ 
+     // --- Inicializace časové základny 1 Hz (Timer1 nebo Timer2/RTC) ---
+     zakladna_init();
+     bzucak_init();          // tón z volného časovače (Timer2 nebo Timer1)
+ #ifdef SVETLO
+     svetlo_init();          // ADC fotorezistoru pro automatický jas
+ #endif
+ #ifdef KONZOLE
+     konz_init();            // sériová konzole na PD0/PD1
+ #endif
+ #ifdef SYNC
+     sync_init();            // sběrnice TWI na PC0/PC1
+ #endif
+ 
+     set_sleep_mode(SLEEP_MODE_IDLE);  // časovače i I/O běží, stojí jen CPU
+ 
+     casovace_init();
+ #ifdef ZAZNAM
+     zaznam_init();       // před teply_start(), který nuluje MCUCSR
+ #endif
+     teply_start();       // nastavení z EEPROM, po resetu od watchdogu/brown‑outu čas i nastavení z .noinit
+ 
+     aktualizuj_displej();
+     led_vyber();
+     wdt_enable(WDT_TIMEOUT);  // krmí ho každý průchod hlavní smyčkou
+     sei(); // povolení globálních přerušení
+ }
+ 
+ /*
+  * Funkce: obsluz_udalosti
+  * -----------------------
+  * Jeden průchod hlavní smyčkou: zpracuje všechny události, které
+  * přerušení nahromadila od minulého průchodu. Nikdy neblokuje.
+  */
+ void obsluz_udalosti(void) {
+ #ifdef PROFIL
+     uint32_t prof_pruchod = prof_cas();
+ #endif
+     uint8_t zmena = 0;  // proběhla událost, která může změnit indikaci LED
+     wdt_reset();        // smyčka běží – zaseknutí kdekoli jinde resetuje CPU
 
-         // Obsluha signalizace budíku a LED indikací režimů
-         if (budik_signal) {
-             // Pokud budík zvoní, bliká LED na PB0 v rytmu stav_led (1 Hz)
-             if (stav_led) {
-                 led_out &= ~(1 << PB0);  // Rozsvítí LED budíku v taktu 1 Hz
+     // 1) Výběr událostí klávesnice z fronty (neblokuje)
+     uint8_t klavesa;
+     while ((klavesa = klav_udalost()) != KLAV_ZADNA) {
+         if (!klav_sleduj(klavesa)) {
+             continue;
+         }
+         ZAZ_UDALOST(ZAZ_KLAVESA, klavesa);
+         klav_opakovani(klavesa);
+         obsluz_klavesu(klavesa);
+         zmena = 1;
+ #ifdef PROFIL
+         prof_kos(prof_klavesa, prof_cas() - prof_klav_cas, PROF_KLAVESA_BIT);
+ #endif
+     }
+ 
+     // 2) Běh času a kontrola budíku každou sekundu
+     //    (dohání všechny sekundy napočítané ISR od minulého průchodu)
+     while (sekundy_zpracovane != sekundy_isr) {
+         sekundy_zpracovane++;
+         obsluz_sekundu();
+         klav_hlidej();
+         zmena = 1;
+     }
+ 
+ #ifdef KONZOLE
+     // 2b) Příkazy sériové konzole (jen hotové řádky, neblokuje)
+     if (konz_radky != konz_radky_zpracovane) {
+         zmena = 1;
+     }
+     obsluz_konzoli();
+ #endif
+ #ifdef SYNC_SLAVE
+     // 2c) Rámec s časem od mastera (dorovnání fáze sekund)
+     zmena |= sync_obsluz();
+ #endif
+ 
+     // 3) Softwarové časovače (krok rytmu, opakování klávesy, uložení)
+     zmena |= obsluz_casovace();
+ 
+     // 4) LED a bzučák se mění jen po události (klávesa, sekunda, časovač);
+     //    kroky rytmu běží jen během zvonění a pro vzory LED, které je potřebují
+     if (zmena) {
+         tepla_uloz();   // kopie pro teplý restart
+ #ifdef ZAZNAM
+         if (rezim_nastaveni != zaz_rezim) {
+             zaz_rezim = rezim_nastaveni;
+             ZAZ_UDALOST(ZAZ_REZIM, zaz_rezim);
+         }
+ #endif
+         led_vyber();
+         if (budik_signal || led_kroky) {
+             if (!casovace[CAS_KROK].bezi) {
+                 casovac_spust(CAS_KROK, KROK_MS, KROK_MS);
              }
          } else {
-             // Pokud budík nezvoní, zobrazují se indikace režimů
-             if (rezim_nastaveni == REZIM_NAST_HOD) {
-                 led_out &= ~(1 << PB2);  // Rozsvítí LED pro režim nastavení hodin
-             }
-             if (rezim_nastaveni == REZIM_NAST_BUD) {
-                 led_out &= ~(1 << PB1);  // Rozsvítí LED pro režim nastavení budíku
+             casovac_zastav(CAS_KROK);
+         }
+ #ifdef SVETLO
+         // automatický jas jen při rozsvíceném displeji
+         if (svetlo_auto && !displej_vypnut) {
+             if (!casovace[CAS_SVETLO].bezi) {
+                 casovac_spust(CAS_SVETLO, SVETLO_MS, SVETLO_MS);
              }
+         } else {
+             casovac_zastav(CAS_SVETLO);
          }
-
-         // Aktualizuje pouze spodní 4 bity PORTB (LED), horní 4 bity zachová beze změny
-         PORTB = (PORTB & ~0x0F) | led_out;  // (~0x0F = 0b11110000)
+ #endif
+     }
+     obsluz_led();
+     obsluz_bzucak();
+ #ifdef ZAZNAM
+     zaznam_uloz();      // dávka záznamů do EEPROM na pozadí
+ #endif
+ #ifdef PROFIL
+     prof_kos(prof_smycka, prof_cas() - prof_pruchod, PROF_SMYCKA_BIT);
+ #endif
+ }
+ 
+ int main(void) {
+     inicializace();
+ 
+     // --- Hlavní smyčka programu – řízená událostmi ---
+     while (1) {
+         obsluz_udalosti();
+         cekej_na_udalost();  // spánek do další události
      }
  }
- 
\ No newline at end of file
@@ -0,0 +1,210 @@
+/*
+ * Náhradní HAL pro překlad main.cpp na PC (simulace, viz simulace.cpp)
+ *
+ * Registry ATmega32A jsou obyčejné proměnné, přerušení obyčejné funkce,
+ * které volá simulace. Tabulky ve flash a EEPROM jsou v RAM. Soubory
+ * sim/avr/… a sim/util/… jen vkládají tento soubor, aby main.cpp šel
+ * přeložit beze změny s -isystem sim.
+ */
+ #ifndef HAL_PC_H
+ #define HAL_PC_H
+ 
+ #include <stdint.h>
+ #include <stddef.h>
+ #include <string.h>
+ 
+ // --- Registry (avr/io.h) ---
+ #define REG8(n)  inline volatile uint8_t n;
+ #define REG16(n) inline volatile uint16_t n;
+ REG8(PORTA) REG8(PORTB) REG8(PORTC) REG8(PORTD)
+ REG8(DDRA)  REG8(DDRB)  REG8(DDRC)  REG8(DDRD)
+ REG8(PINA)  REG8(PINB)  REG8(PINC)  REG8(PIND)
+ REG8(TCCR0) REG8(TCNT0) REG8(OCR0)  REG8(TIMSK) REG8(TIFR)
+ REG8(TCCR1A) REG8(TCCR1B) REG16(OCR1A) REG16(OCR1B) REG16(TCNT1) REG16(ICR1)
+ REG8(TCCR2) REG8(TCNT2) REG8(OCR2)  REG8(ASSR)
+ REG8(UCSRA) REG8(UCSRB) REG8(UCSRC) REG8(UDR) REG8(UBRRH) REG8(UBRRL)
+ REG8(EECR)  REG8(EEDR)  REG16(EEAR)
+ REG8(MCUCSR) REG8(MCUCR) REG8(SREG)
+ REG8(ADMUX) REG8(ADCSRA) REG8(SFIOR) REG16(ADC)
+ REG8(TWBR)  REG8(TWSR)  REG8(TWAR)  REG8(TWDR)  REG8(TWCR)
+ #undef REG8
+ #undef REG16
+ 
+ enum { PA0, PA1, PA2, PA3, PA4, PA5, PA6, PA7 };
+ enum { PB0, PB1, PB2, PB3, PB4, PB5, PB6, PB7 };
+ enum { PC0, PC1, PC2, PC3, PC4, PC5, PC6, PC7 };
+ enum { PD0, PD1, PD2, PD3, PD4, PD5, PD6, PD7 };
+ 
+ // Timer0
+ #define CS00   0
+ #define CS01   1
+ #define CS02   2
+ #define WGM01  3
+ #define COM00  4
+ #define COM01  5
+ #define WGM00  6
+ #define FOC0   7
+ // TIMSK / TIFR
+ #define TOIE0  0
+ #define OCIE0  1
+ #define TOIE1  2
+ #define OCIE1B 3
+ #define OCIE1A 4
+ #define TICIE1 5
+ #define TOIE2  6
+ #define OCIE2  7
+ #define TOV0   0
+ #define OCF0   1
+ #define TOV1   2
+ #define OCF1B  3
+ #define OCF1A  4
+ #define ICF1   5
+ #define TOV2   6
+ #define OCF2   7
+ // Timer1
+ #define WGM10  0
+ #define WGM11  1
+ #define FOC1B  2
+ #define FOC1A  3
+ #define COM1B0 4
+ #define COM1B1 5
+ #define COM1A0 6
+ #define COM1A1 7
+ #define CS10   0
+ #define CS11   1
+ #define CS12   2
+ #define WGM12  3
+ #define WGM13  4
+ #define ICES1  6
+ #define ICNC1  7
+ // Timer2
+ #define CS20   0
+ #define CS21   1
+ #define CS22   2
+ #define WGM21  3
+ #define COM20  4
+ #define COM21  5
+ #define WGM20  6
+ #define FOC2   7
+ #define TCR2UB 0
+ #define OCR2UB 1
+ #define TCN2UB 2
+ #define AS2    3
+ // USART
+ #define U2X    1
+ #define UDRE   5
+ #define TXC    6
+ #define RXC    7
+ #define TXEN   3
+ #define RXEN   4
+ #define UDRIE  5
+ #define TXCIE  6
+ #define RXCIE  7
+ #define UCSZ0  1
+ #define UCSZ1  2
+ #define URSEL  7
+ // MCUCSR
+ #define PORF   0
+ #define EXTRF  1
+ #define BORF   2
+ #define WDRF   3
+ // ADC
+ #define REFS0  6
+ #define ADEN   7
+ #define ADSC   6
+ #define ADATE  5
+ #define ADIF   4
+ #define ADIE   3
+ #define ADPS2  2
+ #define ADPS1  1
+ #define ADPS0  0
+ #define ADTS0  5
+ #define ADTS1  6
+ #define ADTS2  7
+ // EEPROM
+ #define EERE   0
+ #define EEWE   1
+ #define EEMWE  2
+ #define EERIE  3
+ // TWI
+ #define TWIE   0
+ #define TWEN   2
+ #define TWWC   3
+ #define TWSTO  4
+ #define TWSTA  5
+ #define TWEA   6
+ #define TWINT  7
+ #define TWGCE  0
+ 
+ // --- Přerušení (avr/interrupt.h) ---
+ #define ISR(v, ...) extern "C" void v(void); void v(void)
+ #define ISR_NOBLOCK
+ static inline void sei(void) {}
+ static inline void cli(void) {}
+ 
+ // --- Spánek (avr/sleep.h) ---
+ #define SLEEP_MODE_IDLE     0
+ #define SLEEP_MODE_PWR_SAVE 3
+ static inline void set_sleep_mode(uint8_t) {}
+ static inline void sleep_enable(void) {}
+ static inline void sleep_disable(void) {}
+ static inline void sleep_cpu(void) {}
+ 
+ // --- Watchdog (avr/wdt.h) – v simulaci se nikdy nespustí ---
+ #define WDTO_2S 7
+ static inline void wdt_enable(uint8_t) {}
+ static inline void wdt_reset(void) {}
+ 
+ // --- Flash (avr/pgmspace.h) ---
+ #define PROGMEM
+ #define PSTR(s) (s)
+ #define pgm_read_byte(a) (*(const uint8_t *)(a))
+ #define pgm_read_word(a) (*(const uint16_t *)(a))
+ #define pgm_read_ptr(a)  (*(void * const *)(a))
+ 
+ // --- EEPROM (avr/eeprom.h) – obsah je přímo v proměnných EEMEM ---
+ #define EEMEM
+ static inline void eeprom_read_block(void *cil, const void *zdroj, size_t n) {
+     memcpy(cil, zdroj, n);
+ }
+ static inline uint8_t eeprom_read_byte(const uint8_t *a) {
+     return *a;
+ }
+ 
+ // --- util/crc16.h ---
+ static inline uint16_t _crc16_update(uint16_t crc, uint8_t a) {
+     crc ^= a;
+     for (uint8_t i = 0; i < 8; i++) {
+         crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : (crc >> 1);
+     }
+     return crc;
+ }
+ 
+ // --- util/atomic.h – simulace je jednovláknová ---
+ #define ATOMIC_RESTORESTATE 0
+ #define ATOMIC_FORCEON      0
+ #define ATOMIC_BLOCK(typ) for (uint8_t atomic_jednou = 1; atomic_jednou; atomic_jednou = 0)
+ 
+ // --- util/twi.h ---
+ #define TW_STATUS            (TWSR & 0xF8)
+ #define TW_WRITE             0
+ #define TW_READ              1
+ #define TW_START             0x08
+ #define TW_REP_START         0x10
+ #define TW_MT_SLA_ACK        0x18
+ #define TW_MT_SLA_NACK       0x20
+ #define TW_MT_DATA_ACK       0x28
+ #define TW_MT_DATA_NACK      0x30
+ #define TW_MT_ARB_LOST       0x38
+ #define TW_SR_SLA_ACK        0x60
+ #define TW_SR_GCALL_ACK      0x70
+ #define TW_SR_DATA_ACK       0x80
+ #define TW_SR_GCALL_DATA_ACK 0x90
+ #define TW_SR_STOP           0xA0
+ #define TW_BUS_ERROR         0x00
+
+ // --- util/delay.h ---
+ static inline void _delay_us(double) {}
+ static inline void _delay_ms(double) {}
+ 
+ #endif
@@ -0,0 +1,965 @@
+/*
+ * Simulace firmwaru na PC a měření výkonu (make sim, make bench)
+ *
+ * Přeloží main.cpp proti náhradnímu HAL (sim/hal_pc.h) a spouští scénáře:
+ * přerušení časovačů volá přímo, klávesnici napodobuje přes PINC/PINB
+ * podle aktivního řádku a zápis EEPROM provádí do pole ee_nastaveni.
+ * Výsledkem jsou deterministické počty operací (obnovy displeje, přepočty
+ * budíku, zápisy EEPROM …), které se porovnávají se základem v souboru;
+ * vyšší počet než v základu je regrese. Časy na PC jsou jen orientační.
+ *
+ * Použití: simulace [soubor_zakladu]     porovnání se základem
+ *          simulace -u soubor_zakladu    zápis nového základu
+ *          simulace -p soubor_vypisu     přehrání výpisu LOG (jen se ZAZNAM)
+ */
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <time.h>
+
+ // Čítače operací, které firmware hlásí makrem SIM_POCET
+ enum {
+     SIM_DISPLEJ,
+     SIM_SNIMEK,
+     SIM_SEKUNDA,
+     SIM_KLAVESA,
+     SIM_PREPOCET_BUDIKU,
+     SIM_ULOZENI,
+     SIM_LED,
+     SIM_CASOVAC,
+     SIM_CITACU
+ };
+ unsigned long sim_pocty[SIM_CITACU];
+ #define SIM_POCET(c) (sim_pocty[c]++)
+
+ // Každý záznam událostí firmwaru (ZAZNAM) jde i do simulace
+ #ifdef ZAZNAM
+ struct zaznam_t;
+ static void sim_zaznam(const zaznam_t *z);
+ #define SIM_ZAZNAM(z) sim_zaznam(z)
+ #endif
+
+ #define main firmware_main
+ #include "../main.cpp"
+ #undef main
+
+ // --- Stav simulovaného hardwaru ---
+
+ static uint16_t      sim_klavesy = 0;  // maska držených kláves (bit = kód klávesy)
+ static unsigned long sim_ee_bajty = 0; // počet zapsaných bajtů EEPROM (nastavení)
+ static unsigned long sim_ee_zaznam = 0; // počet zapsaných bajtů záznamu událostí
+ static unsigned long sim_zvoneni = 0;  // počet spuštění zvonění
+ static uint8_t       sim_signal = 0;   // minulá hodnota budik_signal
+ #ifdef SVETLO
+ static uint16_t      sim_svetlo = 0;   // výsledek převodu ADC fotorezistoru
+ #endif
+ #ifdef SYNC_MASTER
+ static uint8_t       sim_ramec[SYNC_RAMEC];  // poslední rámec odvysílaný po TWI
+ static unsigned long sim_ramcu = 0;    // počet odvysílaných rámců
+ #endif
+
+ /*
+  * Funkce: sim_vstupy
+  * ------------------
+  * Nastaví PINC (s RTC základnou i PINB) podle držených kláves a řádku
+  * aktivovaného v PORTC (se SYNC řádky 1 a 2 v PORTB): stisknutá klávesa
+  * v aktivním řádku stáhne svůj sloupec do log.0.
+  */
+ static void sim_vstupy(void) {
+ #ifdef SYNC
+     uint8_t radky = (PORTC & 0x0C) | (PORTB >> 6);
+ #else
+     uint8_t radky = PORTC;
+ #endif
+     uint8_t sloupce = 0;
+     for (uint8_t r = 0; r < 4; r++) {
+         if (radky & (1 << r)) {
+             continue;
+         }
+         for (uint8_t s = 0; s < 4; s++) {
+             if (sim_klavesy & (1u << mapa_klaves[r][s])) {
+                 sloupce |= 1 << s;
+             }
+         }
+     }
+ #ifdef ZAKLADNA_RTC
+     PINC = (uint8_t)~((sloupce & 0x03) << 4);
+     PINB = (uint8_t)~((sloupce & 0x0C) << 2);
+ #else
+     PINC = (uint8_t)~(sloupce << 4);
+ #endif
+ }
+
+ /*
+  * Funkce: sim_eeprom
+  * ------------------
+  * Dokončí zápis EEPROM, na který čeká ISR(EE_RDY_vect): bajt z EEDR se
+  * uloží na odpovídající místo v ee_nastaveni nebo ee_zaznam (EEAR je
+  * dolních 16 bitů adresy na PC).
+  */
+ static uint8_t *sim_ee_misto(uint16_t adresa) {
+ #ifdef ZAZNAM
+     uint16_t posun = (uint16_t)(adresa - (uint16_t)(uintptr_t)ee_zaznam);
+     if (posun < sizeof(ee_zaznam)) {
+         return (uint8_t *)ee_zaznam + posun;
+     }
+ #endif
+     return (uint8_t *)ee_nastaveni + (uint16_t)(adresa - (uint16_t)(uintptr_t)ee_nastaveni);
+ }
+
+ static void sim_eeprom(void) {
+     while (EECR & (1 << EERIE)) {
+         EE_RDY_vect();
+         if (EECR & (1 << EEWE)) {
+             uint8_t *misto = sim_ee_misto(EEAR);
+             *misto = EEDR;
+             EECR &= ~((1 << EEWE) | (1 << EEMWE));
+             if (misto >= (uint8_t *)ee_nastaveni && misto < (uint8_t *)ee_nastaveni + sizeof(ee_nastaveni)) {
+                 sim_ee_bajty++;
+             } else {
+                 sim_ee_zaznam++;
+             }
+         }
+     }
+ }
+
+ #ifdef SYNC_MASTER
+ /*
+  * Funkce: sim_sbernice
+  * --------------------
+  * Odvysílá rámec, jehož START firmware vyžádal v TWCR: stavy sběrnice
+  * vkládá do TWSR a volá ISR(TWI_vect), jako by všechno potvrdil slave.
+  */
+ static void sim_sbernice(void) {
+     if (!(TWCR & (1 << TWSTA))) {
+         return;
+     }
+     TWSR = TW_START;
+     TWI_vect();
+     TWSR = (TWDR == (0x00 | TW_WRITE)) ? TW_MT_SLA_ACK : TW_MT_SLA_NACK;
+     for (uint8_t n = 0; ; n++) {
+         TWI_vect();
+         if (TWCR & (1 << TWSTO)) {
+             break;
+         }
+         if (n < SYNC_RAMEC) {
+             sim_ramec[n] = TWDR;
+         }
+         TWSR = TW_MT_DATA_ACK;
+     }
+     TWCR &= ~(1 << TWSTO);   // STOP odvysílán
+     sim_ramcu++;
+ }
+ #endif
+
+ #ifdef SYNC_SLAVE
+ /*
+  * Funkce: sim_prijmi_ramec
+  * ------------------------
+  * Obecné volání s rámcem 'r' od mastera ve chvíli, kdy Timer1 slave
+  * napočítal 'faze' tiků aktuální sekundy.
+  */
+ static void sim_prijmi_ramec(const uint8_t *r, uint16_t faze) {
+     TCNT1 = faze;
+     TWSR = TW_SR_GCALL_ACK;
+     TWI_vect();
+     for (uint8_t i = 0; i < SYNC_RAMEC; i++) {
+         TWDR = r[i];
+         TWSR = TW_SR_GCALL_DATA_ACK;
+         TWI_vect();
+     }
+     TWSR = TW_SR_STOP;
+     TWI_vect();
+ }
+ #endif
+
+ /*
+  * Funkce: sim_udalosti
+  * --------------------
+  * Jeden průchod hlavní smyčkou firmwaru a dokončení zápisů EEPROM
+  * (s SYNC=MASTER i vyžádaného vysílání po TWI).
+  */
+ static void sim_udalosti(void) {
+     obsluz_udalosti();
+     sim_eeprom();
+ #ifdef SYNC_MASTER
+     sim_sbernice();
+ #endif
+     if (budik_signal && !sim_signal) {
+         sim_zvoneni++;
+     }
+     sim_signal = budik_signal;
+ }
+
+ /*
+  * Funkce: sim_sekunda
+  * -------------------
+  * Přerušení časové základny za jednu sekundu.
+  */
+ static void sim_sekunda(void) {
+ #ifdef ZAKLADNA_RTC
+     TIMER2_COMP_vect();
+     TIMER2_COMP_vect();
+ #else
+     TIMER1_COMPA_vect();
+ #endif
+ }
+
+ /*
+  * Funkce: sim_slot / sim_bez
+  * --------------------------
+  * Jeden slot číslice, resp. běh 'ms' milisekund s multiplexem: každý slot číslice jsou dvě
+  * přerušení Timer0 (svit a tma se skenem klávesnice), převod ADC (SVETLO)
+  * spuštěný v zatemnění se dokončí hned po druhém z nich, po slotu průchod
+  * hlavní smyčkou, po MUX_HZ slotech sekunda časové základny.
+  */
+ static void sim_slot(void) {
+     static unsigned long sloty = 0;
+     sim_vstupy();
+     TIMER0_COMP_vect();
+     sim_vstupy();
+     TIMER0_COMP_vect();
+ #ifdef SVETLO
+     if (ADCSRA & (1 << ADSC)) {    // převod spuštěný v zatemnění
+         ADCSRA &= ~(1 << ADSC);
+         ADC = sim_svetlo;
+         ADC_vect();
+     }
+ #endif
+     if (++sloty == MUX_HZ) {
+         sloty = 0;
+         sim_sekunda();
+     }
+     sim_udalosti();
+ }
+
+ static void sim_bez(unsigned long ms) {
+     unsigned long konec = ms * MUX_HZ / 1000;
+     for (unsigned long n = 0; n < konec; n++) {
+         sim_slot();
+     }
+ }
+
+ /*
+  * Funkce: sim_stisk
+  * -----------------
+  * Stiskne klávesu 'kod', drží ji 'drzet' ms a po puštění počká 'mezera' ms.
+  */
+ static void sim_stisk(uint8_t kod, unsigned long drzet, unsigned long mezera) {
+     sim_klavesy |= 1u << kod;
+     sim_bez(drzet);
+     sim_klavesy &= ~(1u << kod);
+     sim_bez(mezera);
+ }
+
+ /*
+  * Funkce: sim_start
+  * -----------------
+  * Studený start firmwaru s prázdnou EEPROM a vynulovanými čítači.
+  * Globální proměnné firmwaru se nenulují – scénáře běží za sebou vždy
+  * ve stejném pořadí, takže počty zůstávají deterministické.
+  */
+ static void sim_start(void) {
+     memset(ee_nastaveni, 0xFF, sizeof(ee_nastaveni));
+ #ifdef ZAZNAM
+     memset(ee_zaznam, 0xFF, sizeof(ee_zaznam));
+     memset(&zaz_ram, 0, sizeof(zaz_ram));   // neplatný kruh v RAM jako po zapnutí
+ #endif
+     inicializace();
+     memset(sim_pocty, 0, sizeof(sim_pocty));
+     sim_ee_bajty = 0;
+     sim_ee_zaznam = 0;
+     sim_zvoneni  = 0;
+     sim_signal   = 0;
+ }
+
+ #ifdef ZAZNAM
+ // --- Přehrání záznamu událostí ---
+
+ #define SIM_ZAZNAMU 1024
+
+ static zaznam_t sim_vystup[SIM_ZAZNAMU];  // změny režimu a zvonění zaznamenané při přehrávání
+ static int      sim_vystupu = 0;
+
+ static void sim_zaznam(const zaznam_t *z) {
+     uint8_t typ = z->typ & ZAZ_TYP;
+     if ((typ == ZAZ_REZIM || typ == ZAZ_ZVONEK) && sim_vystupu < SIM_ZAZNAMU) {
+         sim_vystup[sim_vystupu++] = *z;
+     }
+ }
+
+ static uint8_t sim_bcd(uint16_t n) {
+     return (uint8_t)(((n / 10) << 4) | (n % 10));
+ }
+
+ static const uint8_t sim_priznak_resetu[RESET_PRICIN] = {
+     1 << PORF, 1 << EXTRF, 1 << BORF, 1 << WDRF
+ };
+
+ /*
+  * Funkce: sim_prehraj
+  * -------------------
+  * Deterministicky přehraje 'n' záznamů (výpis LOG): vstupy – resety,
+  * nastavení budíků, události klávesnice v čase podle odstupů a značky
+  * času – se vkládají do firmwaru, výstupy (změny režimu a zvonění) se
+  * porovnávají s těmi, které firmware při přehrávání zaznamená znovu.
+  * Opakování držené klávesy se nezaznamenává, vznikne znovu časovačem.
+  * Stav před prvním záznamem (a nastavení z konzole) se neobnovuje.
+  *
+  * Návrat: počet rozdílů ve výstupech
+  */
+ static int sim_prehraj(const zaznam_t *z, int n) {
+     sim_start();
+     sim_vystupu = 0;
+     uint16_t cil = tik;      // tik, ke kterému se vztahuje další odstup
+     int po_resetu = 1;       // další značka času nastaví hodiny přímo
+     int ocekavano = 0;
+     static zaznam_t vystupy[SIM_ZAZNAMU];
+
+     for (int i = 0; i < n; i++) {
+         uint8_t typ = z[i].typ & ZAZ_TYP;
+         switch (typ) {
+         case ZAZ_RESET: {
+             uint8_t pricina = z[i].data & 0x7F;
+             MCUCSR = pricina < RESET_PRICIN ? sim_priznak_resetu[pricina] : 0;
+             if (pricina == RESET_ZAPNUTI) {
+                 cas       = { 0, 0, 0 };
+                 datum     = { 0x01, 0x01, 0x00 };
+                 den_tydne = 0;
+             }
+             inicializace();
+             cil = tik;
+             po_resetu = 1;
+             break;
+         }
+         case ZAZ_CAS:
+             if (po_resetu) {
+                 uint16_t m = z[i].hodnota % MINUT_DNE;
+                 den_tydne   = z[i].hodnota / MINUT_DNE;
+                 cas.hodiny  = sim_bcd(m / 60);
+                 cas.minuty  = sim_bcd(m % 60);
+                 cas.sekundy = z[i].data;
+                 synchronizuj_minutu_tydne();
+                 prepocitej_dalsi_budik();
+             } else {
+                 // přestávka delší než ZAZ_ZNACKA_SEK – chod až do značky (nejvýše týden)
+                 for (unsigned long s = 0; s < MINUT_TYDNE * 60UL * MUX_HZ
+                      && (minuta_tydne != z[i].hodnota || cas.sekundy != z[i].data); s++) {
+                     sim_slot();
+                 }
+             }
+             cil = tik;
+             po_resetu = 0;
+             break;
+         case ZAZ_BUDIK: {
+             budik_t b;
+             b.cas = { 0, (uint8_t)z[i].hodnota, (uint8_t)(z[i].hodnota >> 8) };
+             b.dny = z[i].data;
+             uint8_t k = (z[i].typ >> ZAZ_INDEX) & (BUDIKU - 1);
+             if (memcmp(&budiky[k], &b, sizeof(b)) != 0) {
+                 budiky[k] = b;
+                 budiky_zmeneny();
+             }
+             break;
+         }
+         case ZAZ_KLAVESA:
+             cil += z[i].hodnota;
+             while ((int16_t)(tik - cil) < 0) {
+                 sim_slot();
+             }
+             klav_vloz(z[i].data);
+             break;
+         default:             // ZAZ_REZIM, ZAZ_ZVONEK – výstupy
+             cil += z[i].hodnota;
+             if (ocekavano < SIM_ZAZNAMU) {
+                 vystupy[ocekavano++] = z[i];
+             }
+             break;
+         }
+     }
+     sim_bez(1000);           // obsluha posledních vložených kláves
+
+     int rozdilu = 0;
+     int pocet = ocekavano > sim_vystupu ? ocekavano : sim_vystupu;
+     for (int i = 0; i < pocet; i++) {
+         int shoda = i < ocekavano && i < sim_vystupu
+                     && (vystupy[i].typ & ZAZ_TYP) == (sim_vystup[i].typ & ZAZ_TYP)
+                     && vystupy[i].data == sim_vystup[i].data;
+         if (!shoda) {
+             if (!rozdilu) {
+                 fprintf(stderr, "prehrani: prvni rozdil ve vystupu %d: zaznam %02X%02X, prehrani %02X%02X\n", i,
+                         i < ocekavano ? vystupy[i].typ & ZAZ_TYP : 0xFF, i < ocekavano ? vystupy[i].data : 0xFF,
+                         i < sim_vystupu ? sim_vystup[i].typ & ZAZ_TYP : 0xFF, i < sim_vystupu ? sim_vystup[i].data : 0xFF);
+             }
+             rozdilu++;
+         }
+     }
+     return rozdilu;
+ }
+
+ /*
+  * Funkce: sim_nacti_vypis
+  * -----------------------
+  * Načte výpis LOG z konzole: záznamem je každý řádek z 8 šestnáctkových
+  * číslic (ostatní řádky – LOST, OK, příkazy – se přeskočí).
+  *
+  * Návrat: počet načtených záznamů, -1 = soubor nelze otevřít
+  */
+ static int sim_nacti_vypis(const char *soubor, zaznam_t *z, int max) {
+     FILE *f = fopen(soubor, "r");
+     if (!f) {
+         return -1;
+     }
+     char radek[64];
+     int n = 0;
+     unsigned int typ, data, hodnota;
+     while (n < max && fgets(radek, sizeof(radek), f)) {
+         char *konec = radek + strcspn(radek, "\r\n");
+         if (konec - radek == 8 && strspn(radek, "0123456789ABCDEFabcdef") == 8
+             && sscanf(radek, "%2x%2x%4x", &typ, &data, &hodnota) == 3) {
+             z[n].typ     = (uint8_t)typ;
+             z[n].data    = (uint8_t)data;
+             z[n].hodnota = (uint16_t)hodnota;
+             n++;
+         }
+     }
+     fclose(f);
+     return n;
+ }
+ #endif
+
+ // --- Výsledky ---
+
+ #define VYSLEDKU 24
+
+ struct vysledek_t {
+     char          nazev[40];
+     unsigned long hodnota;
+     int           porovnat;   // 1 = deterministický počet, porovnává se se základem
+ };
+
+ static vysledek_t vysledky[VYSLEDKU];
+ static int        vysledku = 0;
+
+ static void zapis(const char *scenar, const char *nazev, unsigned long hodnota, int porovnat) {
+     if (vysledku == VYSLEDKU) {
+         fprintf(stderr, "prilis mnoho vysledku\n");
+         exit(2);
+     }
+     vysledek_t *v = &vysledky[vysledku++];
+     snprintf(v->nazev, sizeof(v->nazev), "%s.%s", scenar, nazev);
+     v->hodnota  = hodnota;
+     v->porovnat = porovnat;
+ }
+
+ static double sim_ns(void) {
+     struct timespec t;
+     clock_gettime(CLOCK_MONOTONIC, &t);
+     return t.tv_sec * 1e9 + t.tv_nsec;
+ }
+
+ // --- Scénáře ---
+
+ /*
+  * Scénář „dny“: týden chodu hodin se třemi budíky (pracovní dny 6:30,
+  * víkend 8:15, denně 22:00), zvonění se nechá ztišit automaticky.
+  * Multiplex se nesimuluje, jen sekundy a hlavní smyčka.
+  */
+ static void scenar_dny(void) {
+     sim_start();
+     budiky[0].cas = { 0x00, 0x30, 0x06 };
+     budiky[0].dny = BUDIK_AKTIVNI | 0x1F;
+     budiky[1].cas = { 0x00, 0x15, 0x08 };
+     budiky[1].dny = BUDIK_AKTIVNI | 0x60;
+     budiky[2].cas = { 0x00, 0x00, 0x22 };
+     budiky[2].dny = BUDIK_AKTIVNI | BUDIK_VSECHNY_DNY;
+     budiky_zmeneny();
+     memset(sim_pocty, 0, sizeof(sim_pocty));
+
+     double t = sim_ns();
+     for (unsigned long s = 0; s < 7UL * 24 * 3600; s++) {
+         sim_sekunda();
+         sim_udalosti();
+     }
+     t = sim_ns() - t;
+
+     zapis("dny", "sekundy", sim_pocty[SIM_SEKUNDA], 1);
+     zapis("dny", "obnovy_displeje", sim_pocty[SIM_DISPLEJ], 1);
+     zapis("dny", "snimky", sim_pocty[SIM_SNIMEK], 1);
+     zapis("dny", "prepocty_budiku", sim_pocty[SIM_PREPOCET_BUDIKU], 1);
+     zapis("dny", "zvoneni", sim_zvoneni, 1);
+     zapis("dny", "zapisy_led", sim_pocty[SIM_LED], 1);
+     zapis("dny", "ns_na_sekundu", (unsigned long)(t / (7.0 * 24 * 3600)), 0);
+ }
+
+ /*
+  * Scénář „klavesy“: úprava budíku (D, držení B s opakováním, A, *,
+  * přepnutí dnů 6 a 7, D) a zadání času 06:45 číslicemi v režimu C.
+  */
+ static void scenar_klavesy(void) {
+     sim_start();
+
+     double t = sim_ns();
+     sim_bez(200);
+     sim_stisk(13, 100, 200);    // D – režim budíku
+     sim_stisk(11, 3000, 200);   // B držené 3 s – minuty s opakováním
+     sim_stisk(10, 100, 200);    // A – hodiny
+     sim_stisk(14, 100, 200);    // * – zapnutí budíku
+     sim_stisk(6, 100, 200);     // 6 – sobota
+     sim_stisk(7, 100, 200);     // 7 – neděle
+     sim_stisk(13, 100, 200);    // D – uložení budíku
+     sim_stisk(12, 100, 200);    // C – režim hodin
+     sim_stisk(0, 100, 200);     // 0645
+     sim_stisk(6, 100, 200);
+     sim_stisk(4, 100, 200);
+     sim_stisk(5, 100, 200);
+     sim_stisk(12, 100, 200);    // C – uložení času
+     sim_bez(1000);
+     t = sim_ns() - t;
+
+     if (cas.hodiny != 0x06 || cas.minuty != 0x45 || !(budiky[0].dny & BUDIK_AKTIVNI)) {
+         fprintf(stderr, "klavesy: neocekavany stav %02X:%02X dny %02X\n",
+                 cas.hodiny, cas.minuty, budiky[0].dny);
+         exit(2);
+     }
+     zapis("klavesy", "udalosti", sim_pocty[SIM_KLAVESA], 1);
+     zapis("klavesy", "obnovy_displeje", sim_pocty[SIM_DISPLEJ], 1);
+     zapis("klavesy", "snimky", sim_pocty[SIM_SNIMEK], 1);
+     zapis("klavesy", "ulozeni", sim_pocty[SIM_ULOZENI], 1);
+     zapis("klavesy", "bajty_eeprom", sim_ee_bajty, 1);
+     zapis("klavesy", "zapisy_led", sim_pocty[SIM_LED], 1);
+     zapis("klavesy", "casovace", sim_pocty[SIM_CASOVAC], 1);
+     zapis("klavesy", "us_celkem", (unsigned long)(t / 1e3), 0);
+ }
+
+ /*
+  * Scénář „displej“: cena sestavení snímku displeje a jednoho přerušení
+  * multiplexu na PC.
+  */
+ static void scenar_displej(void) {
+     const unsigned long opakovani = 1000000;
+     sim_start();
+
+     double t = sim_ns();
+     for (unsigned long n = 0; n < opakovani; n++) {
+         aktualizuj_displej();
+     }
+     zapis("displej", "ns_snimek", (unsigned long)((sim_ns() - t) / opakovani), 0);
+
+     t = sim_ns();
+     for (unsigned long n = 0; n < opakovani; n++) {
+         TIMER0_COMP_vect();
+     }
+     zapis("displej", "ns_multiplex", (unsigned long)((sim_ns() - t) / opakovani), 0);
+ }
+
+ /*
+  * Scénář „zaseknuti“: klávesa 9 držená přes KLAV_ZASEKNUTI_SEK se vyřadí,
+  * akord C+D během toho dál funguje (odloží zvonící budík) a po puštění
+  * se klávesa znovu povolí.
+  */
+ static void scenar_zaseknuti(void) {
+     sim_start();
+     sim_klavesy = 1u << 9;
+     sim_bez((KLAV_ZASEKNUTI_SEK + 1) * 1000UL);
+     uint16_t vadne = klav_vadne;
+     zvonek_udalost(UD_BUDIK);
+     sim_klavesy |= (1u << 12) | (1u << 13);   // C a D současně
+     sim_bez(200);
+     sim_klavesy &= ~((1u << 12) | (1u << 13));
+     sim_bez(200);
+     uint8_t odlozeno = zvonek_stav == ZVONEK_ODLOZENO;
+     zvonek_udalost(UD_VYPNI);
+     sim_klavesy = 0;
+     sim_bez(4000);
+     if (vadne != (1u << 9) || !odlozeno || klav_vadne != 0 || klav_zaseknuti == 0) {
+         fprintf(stderr, "zaseknuti: vadne %04X odlozeno %u po pusteni %04X\n",
+                 vadne, odlozeno, (uint16_t)klav_vadne);
+         exit(2);
+     }
+     zapis("zaseknuti", "udalosti", sim_pocty[SIM_KLAVESA], 1);
+ }
+ 
+ /*
+  * Scénář „led“: odložení budíku klávesou uprostřed sekundy spustí kroky
+  * rytmu mimo začátek sekundy. Dvojité bliknutí PB0 pak musí mít každou
+  * sekundu dva pulzy po celém kroku KROK_MS (tolerance dva sloty).
+  */
+ static void scenar_led(void) {
+     sim_start();
+     sim_bez(1060);
+     zvonek_udalost(UD_BUDIK);
+     sim_stisk(5, 100, 0);          // odložení uprostřed sekundy
+     unsigned long s = sekundy_isr;
+     while (sekundy_isr == s) {
+         sim_slot();
+     }
+
+     const unsigned long krok = KROK_MS * MUX_HZ / 1000;   // krok ve slotech
+     unsigned long pulzu = 0, delka = 0, spatnych = 0;
+     for (unsigned long n = 0; n < 4 * MUX_HZ; n++) {
+         sim_slot();
+         if ((PORTB ^ deska::led::uroven(0)) & (1 << PB0)) {
+             delka++;
+         } else if (delka) {
+             pulzu++;
+             if (delka + 2 < krok || delka > krok + 2) {
+                 spatnych++;
+             }
+             delka = 0;
+         }
+     }
+     if (zvonek_stav != ZVONEK_ODLOZENO || pulzu != 8 || spatnych) {
+         fprintf(stderr, "led: stav %u, pulzu %lu, z toho spatne delky %lu\n",
+                 zvonek_stav, pulzu, spatnych);
+         exit(2);
+     }
+     zvonek_udalost(UD_VYPNI);
+     sim_bez(4000);
+     zapis("led", "zapisy", sim_pocty[SIM_LED], 1);
+ }
+
+ /*
+  * Scénář „uprava“: zadání 12:00 v režimu C, zatímco běžící hodiny
+  * přejdou přes celou hodinu – úprava se jich nedotkne, displej se během
+  * ní kvůli chodu hodin nepřekresluje a C převezme čas najednou.
+  */
+ static void scenar_uprava(void) {
+     sim_start();
+     cas = { 0x57, 0x59, 0x10 };
+     synchronizuj_minutu_tydne();
+     sim_bez(200);
+     sim_stisk(12, 100, 200);    // C – režim hodin
+     sim_stisk(1, 100, 200);     // 1200
+     sim_stisk(2, 100, 200);
+     sim_stisk(0, 100, 200);
+     sim_stisk(0, 100, 200);
+     sim_bez(2000);              // hodiny mezitím přejdou na 11:00
+     cas_t bezi = cas;
+     unsigned long obnovy = sim_pocty[SIM_DISPLEJ];
+     sim_stisk(12, 100, 200);    // C – převzetí
+     if (bezi.hodiny != 0x11 || bezi.minuty != 0x00 || cas.hodiny != 0x12 || cas.minuty != 0x00
+         || cas.sekundy > 0x01) {
+         fprintf(stderr, "uprava: behem %02X:%02X, po prevzeti %02X:%02X:%02X\n",
+                 bezi.hodiny, bezi.minuty, cas.hodiny, cas.minuty, cas.sekundy);
+         exit(2);
+     }
+     zapis("uprava", "obnovy_displeje", obnovy, 1);
+ }
+
+ /*
+  * Scénář „restart“: reset od watchdogu uprostřed chodu musí obnovit čas,
+  * datum a nastavení z .noinit (EEPROM se přitom smaže, aby se ukázalo,
+  * že se nečte), zapnutí napájení (zde s porušenou kopií) ne. Nulování
+  * RAM startovacím kódem simuluje ruční vynulování času a budíku.
+  */
+ static void scenar_restart(void) {
+     sim_start();
+     cas   = { 0x58, 0x59, 0x23 };
+     datum = { 0x28, 0x02, 0x24 };
+     budiky[3].cas = { 0x00, 0x45, 0x05 };
+     nastaveni_uloz();
+     sim_bez(2000);                 // přes půlnoc na 29.02.2024
+     cas_t   c = cas;
+     datum_t d = datum;
+
+     cas   = { 0, 0, 0 };
+     datum = { 0x01, 0x01, 0x00 };
+     budiky[3].cas = { 0, 0, 0 };
+     memset(ee_nastaveni, 0xFF, sizeof(ee_nastaveni));
+     MCUCSR = 1 << WDRF;
+     inicializace();
+     unsigned long obnoveno = restart_teply && memcmp(&cas, &c, sizeof(c)) == 0
+                              && memcmp(&datum, &d, sizeof(d)) == 0 && d.den == 0x29
+                              && budiky[3].cas.minuty == 0x45;
+
+     cas = { 0, 0, 0 };
+     tepla_kopie.crc ^= 0xFFFF;     // náhodný obsah RAM po zapnutí
+     MCUCSR = 1 << PORF;
+     inicializace();
+     if (!obnoveno || restart_teply || cas.minuty != 0 || MCUCSR != 0) {
+         fprintf(stderr, "restart: obnoveno %lu, po zapnuti teply %u\n", obnoveno, restart_teply);
+         exit(2);
+     }
+     zapis("restart", "resety_zapnuti", tepla_kopie.resety[RESET_ZAPNUTI], 1);
+ }
+
+ #ifdef SVETLO
+ /*
+  * Scénář „svetlo“: B zapne automatický jas, ten sleduje skok okolního
+  * světla nahoru i dolů; šum kolem hranice úrovní jas nemění a ruční
+  * změna jasu automatiku vypne.
+  */
+ static void scenar_svetlo(void) {
+     sim_start();
+     sim_svetlo = 1000;
+     sim_stisk(11, 100, 100);
+     sim_bez(5000);
+     uint8_t jasne = jas;
+     sim_svetlo = 100;
+     sim_bez(5000);
+     uint8_t tmave = jas;
+     unsigned long snimky = sim_pocty[SIM_SNIMEK];
+     for (int n = 0; n < 20; n++) {   // šum ±1,5 % kolem hranice úrovní 1 a 2
+         sim_svetlo = (n & 1) ? 120 : 136;
+         sim_bez(500);
+     }
+     uint8_t stabilni = jas == tmave || jas == tmave + 1;
+     unsigned long zmen = sim_pocty[SIM_SNIMEK] - snimky;
+     sim_stisk(15, 100, 100);
+     if (jasne != JAS_UROVNI - 1 || tmave != 1 || !stabilni || svetlo_auto) {
+         fprintf(stderr, "svetlo: jasne %u tmave %u nyni %u auto %u\n", jasne, tmave, jas, svetlo_auto);
+         exit(2);
+     }
+     zapis("svetlo", "snimky_sum", zmen, 1);
+ }
+ #endif
+
+ #ifdef SYNC_MASTER
+ /*
+  * Scénář „sync“ (master): přes dvě celé minuty se na začátku každé
+  * odvysílá jeden rámec s novým časem, dnem v týdnu a datem.
+  */
+ static void scenar_sync(void) {
+     sim_start();
+     cas       = { 0x50, 0x59, 0x23 };
+     datum     = { 0x31, 0x12, 0x25 };
+     den_tydne = 6;
+     synchronizuj_minutu_tydne();
+     sim_ramcu = 0;
+     sim_bez(75000);
+     const uint8_t ocekavany[SYNC_RAMEC] = { 0x00, 0x01, 0x00, 0, 0x01, 0x01, 0x26 };
+     if (sim_ramcu != 2 || memcmp(sim_ramec, ocekavany, SYNC_RAMEC) != 0 || sync_chyby) {
+         fprintf(stderr, "sync: %lu ramcu, posledni %02X:%02X:%02X %u %02X.%02X.%02X\n", sim_ramcu,
+                 sim_ramec[2], sim_ramec[1], sim_ramec[0], sim_ramec[3], sim_ramec[4], sim_ramec[5], sim_ramec[6]);
+         exit(2);
+     }
+     zapis("sync", "ramce", sim_ramcu, 1);
+ }
+ #endif
+
+ #ifdef SYNC_SLAVE
+ /*
+  * Scénář „sync“ (slave): hodiny o 1,296 s pozadu dorovnají fázi zkrácením
+  * následujících sekund – čas nikdy necouvne a součet úprav délky sekund
+  * je právě odchylka. Hodiny o dvě hodiny vedle se srovnají skokem
+  * a zbytek fáze se opět rozloží. Skok na rámec z 23:59:59 zpracovaný až
+  * po další místní sekundě musí posunout i datum a den v týdnu.
+  */
+ static void scenar_sync(void) {
+     sim_start();
+     cas   = { 0x58, 0x00, 0x10 };
+     datum = { 0x14, 0x10, 0x26 };
+     den_tydne = 2;
+     synchronizuj_minutu_tydne();
+     const uint8_t ramec[SYNC_RAMEC] = { 0x00, 0x01, 0x10, 2, 0x14, 0x10, 0x26 };
+     sim_prijmi_ramec(ramec, 11000);          // místně 10:00:58,704
+     sim_udalosti();
+     int32_t odchylka = sync_zbyva;
+     long    soucet   = 0;
+     unsigned long sekund = 0;
+     int32_t minule = sync_sekunda_dne(&cas);
+     uint8_t  couvlo = 0;
+     while (sync_zbyva && sekund < 1000) {
+         sim_sekunda();
+         soucet += (long)OCR1A + 1 - T1_PERIODA;
+         sim_udalosti();
+         int32_t ted = sync_sekunda_dne(&cas);
+         couvlo |= ted <= minule;
+         minule = ted;
+         sekund++;
+     }
+     if (odchylka != -20250 || soucet != odchylka || couvlo) {
+         fprintf(stderr, "sync: odchylka %ld, soucet uprav %ld, couvlo %u\n", (long)odchylka, soucet, couvlo);
+         exit(2);
+     }
+     zapis("sync", "sekundy_dorovnani", sekund, 1);
+
+     cas = { 0x30, 0x00, 0x08 };
+     synchronizuj_minutu_tydne();
+     const uint8_t skok[SYNC_RAMEC] = { 0x00, 0x05, 0x10, 3, 0x15, 0x10, 0x26 };
+     sim_prijmi_ramec(skok, 3000);
+     sim_udalosti();
+     if (cas.hodiny != 0x10 || cas.minuty != 0x05 || den_tydne != 3 || datum.den != 0x15
+         || sync_zbyva != 3000 || sync_skoky != 1 || sync_chyby) {
+         fprintf(stderr, "sync: skok na %02X:%02X den %u %02X., zbyva %d, skoku %u\n",
+                 cas.hodiny, cas.minuty, den_tydne, datum.den, sync_zbyva, sync_skoky);
+         exit(2);
+     }
+
+     cas = { 0x00, 0x00, 0x12 };
+     synchronizuj_minutu_tydne();
+     const uint8_t pulnoc[SYNC_RAMEC] = { 0x59, 0x59, 0x23, 5, 0x31, 0x10, 0x26 };
+     sim_prijmi_ramec(pulnoc, 3000);
+     sim_sekunda();                           // rámec se zpracuje až po další sekundě
+     sim_udalosti();
+     if (cas.hodiny != 0x00 || cas.minuty != 0x00 || cas.sekundy != 0x00 || den_tydne != 6
+         || datum.den != 0x01 || datum.mesic != 0x11 || minuta_tydne != 6 * MINUT_DNE
+         || sync_skoky != 2) {
+         fprintf(stderr, "sync: skok pres pulnoc na %02X:%02X:%02X den %u %02X.%02X., minuta tydne %u\n",
+                 cas.hodiny, cas.minuty, cas.sekundy, den_tydne, datum.den, datum.mesic, minuta_tydne);
+         exit(2);
+     }
+ }
+ #endif
+
+ #ifdef ZAZNAM
+ /*
+  * Scénář „zaznam“: budík nastavený v režimu D zazvoní, odloží se
+  * klávesou 5, znovu zazvoní a vypne se #; mezi tím přestávka delší než
+  * ZAZ_ZNACKA_SEK. Výpis záznamu (EEPROM i RAM) se přehraje a výstupy
+  * se musí shodovat se záznamem.
+  */
+ static void scenar_zaznam(void) {
+     sim_start();
+     cas       = { 0x50, 0x29, 0x06 };
+     den_tydne = 2;
+     synchronizuj_minutu_tydne();
+     budiky[0].cas = { 0x00, 0x30, 0x06 };
+     budiky[0].dny = BUDIK_AKTIVNI | BUDIK_VSECHNY_DNY;
+     budiky_zmeneny();
+     nastaveni_uloz();
+     sim_bez(500);
+     sim_stisk(13, 100, 200);    // D – režim budíku
+     sim_stisk(11, 100, 200);    // B – 06:31
+     sim_stisk(11, 100, 200);    // B – 06:32
+     sim_stisk(13, 100, 200);    // D – uložení budíku
+     sim_stisk(12, 100, 200);    // C – režim hodin a zpět bez změny
+     sim_stisk(12, 100, 200);
+     sim_bez(200 * 1000UL);      // zvonění v 06:32:00 (C vynulovalo sekundy)
+     sim_stisk(5, 100, 200);     // odložení o ODLOZENI_MINUT
+     sim_bez(ODLOZENI_MINUT * 60 * 1000UL + 2000);
+     sim_stisk(15, 100, 200);    // # – vypnutí
+     sim_bez(1000);
+     unsigned long bajty = sim_ee_zaznam;
+     unsigned long zvoneni = sim_zvoneni;
+
+     static zaznam_t vypis[ZAZ_EEPROM + ZAZ_RAM];
+     int n = 0;
+     for (int i = 0; i < ZAZ_EEPROM + ZAZ_RAM; i++) {
+         if (zaznam_cti(i, &vypis[n])) {
+             n++;
+         }
+     }
+     int rozdilu = sim_prehraj(vypis, n);
+     if (zvoneni != 2 || rozdilu || sim_zvoneni != 2) {
+         fprintf(stderr, "zaznam: zvoneni %lu/%lu, %d rozdilu z %d zaznamu\n", zvoneni, sim_zvoneni, rozdilu, n);
+         exit(2);
+     }
+     zapis("zaznam", "zaznamu", n, 1);
+     zapis("zaznam", "bajty_eeprom", bajty, 1);
+ }
+ #endif
+
+ // --- Základ ---
+
+ /*
+  * Funkce: porovnej
+  * ----------------
+  * Vypíše výsledky a porovná deterministické počty se základem ze souboru
+  * (řádky „název hodnota“). Návrat: počet regresí.
+  */
+ static int porovnej(const char *soubor) {
+     FILE *f = soubor ? fopen(soubor, "r") : NULL;
+     if (soubor && !f) {
+         fprintf(stderr, "nelze otevrit %s, porovnani se preskakuje\n", soubor);
+     }
+     char nazev[40];
+     unsigned long hodnota;
+     unsigned long zaklad[VYSLEDKU];
+     int ma_zaklad[VYSLEDKU] = { 0 };
+     while (f && fscanf(f, "%39s %lu", nazev, &hodnota) == 2) {
+         for (int i = 0; i < vysledku; i++) {
+             if (strcmp(vysledky[i].nazev, nazev) == 0) {
+                 zaklad[i]    = hodnota;
+                 ma_zaklad[i] = 1;
+             }
+         }
+     }
+     if (f) {
+         fclose(f);
+     }
+
+     int regrese = 0;
+     printf("%-28s %12s %12s\n", "vysledek", "hodnota", "zaklad");
+     for (int i = 0; i < vysledku; i++) {
+         const vysledek_t *v = &vysledky[i];
+         printf("%-28s %12lu ", v->nazev, v->hodnota);
+         if (!v->porovnat) {
+             printf("%12s\n", "(cas)");
+         } else if (!ma_zaklad[i]) {
+             printf("%12s\n", "-");
+         } else if (v->hodnota > zaklad[i]) {
+             printf("%12lu  REGRESE\n", zaklad[i]);
+             regrese++;
+         } else {
+             printf("%12lu\n", zaklad[i]);
+         }
+     }
+     return regrese;
+ }
+
+ static void uloz_zaklad(const char *soubor) {
+     FILE *f = fopen(soubor, "w");
+     if (!f) {
+         fprintf(stderr, "nelze zapsat %s\n", soubor);
+         exit(2);
+     }
+     for (int i = 0; i < vysledku; i++) {
+         if (vysledky[i].porovnat) {
+             fprintf(f, "%s %lu\n", vysledky[i].nazev, vysledky[i].hodnota);
+         }
+     }
+     fclose(f);
+ }
+
+ int main(int argc, char **argv) {
+     if (argc > 2 && strcmp(argv[1], "-p") == 0) {
+ #ifdef ZAZNAM
+         static zaznam_t vypis[SIM_ZAZNAMU];
+         int n = sim_nacti_vypis(argv[2], vypis, SIM_ZAZNAMU);
+         if (n < 0) {
+             fprintf(stderr, "nelze otevrit %s\n", argv[2]);
+             return 2;
+         }
+         int rozdilu = sim_prehraj(vypis, n);
+         printf("prehrano %d zaznamu, %d vystupu, %d rozdilu\n", n, sim_vystupu, rozdilu);
+         return rozdilu ? 1 : 0;
+ #else
+         fprintf(stderr, "prehrani vyzaduje preklad se ZAZNAM=1\n");
+         return 2;
+ #endif
+     }
+     int aktualizovat = argc > 2 && strcmp(argv[1], "-u") == 0;
+     const char *soubor = aktualizovat ? argv[2] : (argc > 1 ? argv[1] : NULL);
+
+     scenar_dny();
+     scenar_klavesy();
+     scenar_displej();
+     scenar_zaseknuti();
+     scenar_led();
+     scenar_uprava();
+     scenar_restart();
+ #ifdef SVETLO
+     scenar_svetlo();
+ #endif
+ #ifdef ZAZNAM
+     scenar_zaznam();
+ #endif
+ #ifdef SYNC
+     scenar_sync();
+ #endif
+
+     if (aktualizovat) {
+         uloz_zaklad(soubor);
+         porovnej(NULL);
+         printf("zaklad zapsan do %s\n", soubor);
+         return 0;
+     }
+     int regrese = porovnej(soubor);
+     if (regrese) {
+         printf("%d regrese proti zakladu\n", regrese);
+         return 1;
+     }
+     return 0;
+ }
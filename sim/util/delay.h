@@ -0,0 +1,2 @@
+// Náhrada pro simulaci na PC, viz sim/hal_pc.h
+ #include "../hal_pc.h"